@@ -0,0 +1,921 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+#ifndef _ARCHIVE_JSON_H_
+#define _ARCHIVE_JSON_H_
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Archive_xmlrpc_c.h"
+
+/// @brief Boost output archive class which writes a JSON object directly to
+/// a std::ostream
+///
+/// Oarchive_json accepts the same serialize() methods as Oarchive_xmlrpc_c,
+/// selects its handling of each member by the same type traits, and writes
+/// the JSON equivalent of the xmlrpc_c::value_struct which Oarchive_xmlrpc_c
+/// would generate, without building any xmlrpc_c::value objects:
+///
+/// - the class version is written as member "class_version"
+/// - enumerated and integral types are written as JSON numbers, with
+///   unsigned values written as their bitwise-equivalent signed value (see
+///   IntegralWire_xmlrpc_c)
+/// - bool, double and float are written as JSON true/false and numbers; NaN
+///   is written as null and infinities as +/-1e999
+/// - std::string and SharedString_xmlrpc_c are written as JSON strings
+/// - std::vector<unsigned char> and SharedBytes_xmlrpc_c are written as
+///   base64-encoded JSON strings
+/// - ScaledFloat_xmlrpc_c and ScaledFloatArray_xmlrpc_c are written as their
+///   integer encoding and a JSON array of integer encodings
+/// - serializable class members (including LazyXmlrpcSerializable<T>) are
+///   written as nested JSON objects
+///
+/// An Oarchive_json holds exactly one object: its members are written as
+/// the members of a single JSON object, so saving a second object to the
+/// same archive throws std::runtime_error. Use a separate archive for each
+/// object. The opening brace of the object is written when the archive is
+/// constructed, and the closing brace by finish(), or when the archive is
+/// destroyed if finish() was not called, much as
+/// boost::archive::xml_oarchive writes its closing tag. The JSON text is
+/// not complete until then:
+///
+///   std::ostringstream os;
+///   {
+///       Oarchive_json oar(os);
+///       oar << status;
+///   }   // or oar.finish()
+///   std::string json = os.str();
+class Oarchive_json :
+    public boost::archive::detail::common_oarchive<Oarchive_json> {
+public:
+    /// @brief Archive as a JSON object written to the given stream
+    /// @param os the stream to write to
+    Oarchive_json(std::ostream & os) :
+        _os(os),
+        _firstMember(true),
+        _objectSaved(false),
+        _finished(false) {
+        _os.put('{');
+    }
+
+    ~Oarchive_json() {
+        finish();
+    }
+
+    /// @brief Write the closing brace of the JSON object, completing the
+    /// text. Further saves to the archive throw std::runtime_error. This is
+    /// called by the destructor if it has not been called already.
+    void finish() {
+        if (! _finished) {
+            _os.put('}');
+            _finished = true;
+        }
+    }
+
+    // default processing - kick back to our superclass. Only top-level
+    // objects come through here, since nested objects are written by their
+    // own archive (see _writeObject()).
+    template<class T>
+    void save_override(const T & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        if (_objectSaved || _finished) {
+            std::ostringstream ss;
+            ss << "Oarchive_json holds a single object and " <<
+                  (_finished ? "has been finished" : "already holds one") <<
+                  "; use a separate archive for each object";
+            throw(std::runtime_error(ss.str()));
+        }
+        _objectSaved = true;
+        boost::archive::detail::common_oarchive<Oarchive_json>::save_override(t ARCHIVE_XMLRPC_C_PFTO_ARG);
+    }
+
+    // Add special key "class_version" to hold the version number of the
+    // class we're archiving.
+    void save_override(const boost::archive::version_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey("class_version");
+        _writeInteger(static_cast<int>(t));
+    }
+
+    // Don't bother archiving tracking_type, class_id_optional_type Boost special values
+    void save_override(const boost::archive::tracking_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+    void save_override(const boost::archive::class_id_optional_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is an enumerated type
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::true_type is_enum,
+                           std::false_type is_class,
+                           std::false_type is_integral
+                          ) {
+        _writeKey(pair.name());
+        _writeInteger(int(pair.value()));
+    }
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is a class with a serialize() method
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::true_type is_class,
+                           std::false_type is_integral
+                          ) {
+        _writeKey(pair.name());
+        _writeObject(pair.value());
+    }
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is an integral type
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::false_type is_class,
+                           std::true_type is_integral
+                          ) {
+        _writeKey(pair.name());
+        _writeInteger(IntegralWire_xmlrpc_c<T>::encode(pair.value()));
+    }
+
+    // Template save_override for boost::serialization::nvp<T>
+    // (name/value pairs)
+    //
+    // This template uses one of the nvp_save_override specializations above,
+    // selected at compile time based on T's type traits
+    template<typename T>
+    void save_override(const boost::serialization::nvp<T> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        nvp_save_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
+    }
+
+    // name-value pair handling for bool values
+    void save_override(const boost::serialization::nvp<bool> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeRaw(pair.value() ? "true" : "false");
+    }
+
+    // name-value pair handling for double values
+    void save_override(const boost::serialization::nvp<double> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeFloat(pair.value(), "%.17g");
+    }
+
+    // name-value pair handling for float values. Fewer digits are needed to
+    // reproduce a float than a double.
+    void save_override(const boost::serialization::nvp<float> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeFloat(pair.value(), "%.9g");
+    }
+
+    // name-value pair handling for std::string values
+    void save_override(const boost::serialization::nvp<std::string> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeString(pair.value());
+    }
+
+    // name-value pair handling for byte string values
+    void save_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeBase64(pair.value());
+    }
+
+    // name-value pair handling for LazyXmlrpcSerializable<T> values
+    template<typename T>
+    void save_override(const boost::serialization::nvp<LazyXmlrpcSerializable<T>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeObject(pair.value().get());
+    }
+
+    // name-value pair handling for SharedBuffer_xmlrpc_c<T> values
+    template<typename T>
+    void save_override(const boost::serialization::nvp<SharedBuffer_xmlrpc_c<T>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _writeKey(pair.name());
+        _writeContent(pair.value().get());
+    }
+
+    // name-value pair handling for ScaledFloat_xmlrpc_c values, which are
+    // written as their integer encoding
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloat_xmlrpc_c<Float, Step, Offset>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        typedef typename ScaledFloat_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        int32_t wire = Encoding::encode(pair.value(), pair.name());
+        _writeKey(pair.name());
+        _writeInteger(wire);
+    }
+
+    // name-value pair handling for ScaledFloatArray_xmlrpc_c values, which
+    // are written as a JSON array of their integer encodings
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloatArray_xmlrpc_c<Float, Step, Offset>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        typedef typename ScaledFloatArray_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        std::vector<int32_t> wire(pair.value().size());
+        Encoding::encode(pair.value().data(), wire.data(), wire.size(), pair.name());
+        _writeKey(pair.name());
+        _os.put('[');
+        for (size_t i = 0; i < wire.size(); i++) {
+            if (i) {
+                _os.put(',');
+            }
+            _writeInteger(wire[i]);
+        }
+        _os.put(']');
+    }
+
+    // Not sure why we need this, but things won't compile without it...
+    template<class T>
+    void save(T & t) {
+        std::ostringstream ss;
+        ss << "Oarchive_json only deals with name-value pairs, \n" <<
+              "failed to save from (mangled) type: " <<
+              typeid(T).name() << "\n" <<
+              "\n(Try 'c++filt -t <type>' to demangle the type name.)";
+        throw(std::runtime_error(ss.str()));
+    }
+
+private:
+    friend class boost::archive::detail::common_oarchive<Oarchive_json>;
+
+    // Write the given text as is
+    void _writeRaw(const char * text) {
+        _os.write(text, std::strlen(text));
+    }
+
+    // Write the separator if needed, then the quoted key and a colon
+    void _writeKey(const char * key) {
+        if (! _firstMember) {
+            _os.put(',');
+        }
+        _firstMember = false;
+        _writeString(key, std::strlen(key));
+        _os.put(':');
+    }
+
+    // Write a serializable object as a nested JSON object using a new
+    // archive on the same stream
+    template<typename T>
+    void _writeObject(const T & t) {
+        Oarchive_json nestedOar(_os);
+        nestedOar << t;
+    }
+
+    void _writeInteger(long long value) {
+        char buf[24];
+        int len = std::snprintf(buf, sizeof(buf), "%lld", value);
+        _os.write(buf, len);
+    }
+
+    // Write a floating point value. JSON has no NaN or infinity, so NaN is
+    // written as null, and infinities as numbers too large for a double.
+    void _writeFloat(double value, const char * format) {
+        if (std::isnan(value)) {
+            _writeRaw("null");
+        } else if (std::isinf(value)) {
+            _writeRaw(value > 0 ? "1e999" : "-1e999");
+        } else {
+            char buf[32];
+            int len = std::snprintf(buf, sizeof(buf), format, value);
+            _os.write(buf, len);
+        }
+    }
+
+    void _writeContent(const std::string & value) { _writeString(value); }
+    void _writeContent(const std::vector<unsigned char> & value) { _writeBase64(value); }
+
+    void _writeString(const std::string & value) {
+        _writeString(value.data(), value.size());
+    }
+
+    // Write a quoted string, escaping as required by JSON. Runs of
+    // characters which need no escaping are written in one piece.
+    void _writeString(const char * str, size_t len) {
+        static const char HexDigits[] = "0123456789abcdef";
+        _os.put('"');
+        size_t runStart = 0;
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = str[i];
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            _os.write(str + runStart, i - runStart);
+            runStart = i + 1;
+            switch (c) {
+            case '"':  _os.write("\\\"", 2); break;
+            case '\\': _os.write("\\\\", 2); break;
+            case '\n': _os.write("\\n", 2); break;
+            case '\r': _os.write("\\r", 2); break;
+            case '\t': _os.write("\\t", 2); break;
+            default:
+                char esc[6] = { '\\', 'u', '0', '0', HexDigits[c >> 4], HexDigits[c & 0xf] };
+                _os.write(esc, 6);
+                break;
+            }
+        }
+        _os.write(str + runStart, len - runStart);
+        _os.put('"');
+    }
+
+    // Write a byte string as a quoted base64 string
+    void _writeBase64(const std::vector<unsigned char> & bytes) {
+        static const char Base64Chars[] =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string encoded;
+        encoded.reserve(((bytes.size() + 2) / 3) * 4 + 2);
+        encoded.push_back('"');
+        size_t i = 0;
+        for (; i + 2 < bytes.size(); i += 3) {
+            unsigned long triple = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+            encoded.push_back(Base64Chars[(triple >> 18) & 0x3f]);
+            encoded.push_back(Base64Chars[(triple >> 12) & 0x3f]);
+            encoded.push_back(Base64Chars[(triple >> 6) & 0x3f]);
+            encoded.push_back(Base64Chars[triple & 0x3f]);
+        }
+        if (i < bytes.size()) {
+            unsigned long triple = bytes[i] << 16;
+            if (i + 1 < bytes.size()) {
+                triple |= bytes[i + 1] << 8;
+            }
+            encoded.push_back(Base64Chars[(triple >> 18) & 0x3f]);
+            encoded.push_back(Base64Chars[(triple >> 12) & 0x3f]);
+            encoded.push_back(i + 1 < bytes.size() ? Base64Chars[(triple >> 6) & 0x3f] : '=');
+            encoded.push_back('=');
+        }
+        encoded.push_back('"');
+        _os.write(encoded.data(), encoded.size());
+    }
+
+    std::ostream & _os;
+    bool _firstMember;
+    bool _objectSaved;
+    bool _finished;
+};
+
+/// @brief Boost input archive class to unpack from JSON text generated by
+/// Oarchive_json (or by a peer following the same conventions).
+///
+/// The JSON object's members are indexed in a single pass over the text,
+/// which records where each member's value lies without decoding it. Values
+/// are then decoded directly from the text as serialize() asks for them, and
+/// nested objects are indexed only when they are loaded. No xmlrpc_c::value
+/// objects are built.
+class Iarchive_json :
+    public boost::archive::detail::common_iarchive<Iarchive_json> {
+public:
+    /// @brief Unpack from the given JSON text. The archive keeps its own copy
+    /// of the text, so pass an rvalue to avoid copying.
+    /// @param json the JSON text holding an object
+    Iarchive_json(std::string json) :
+        _ownedText(std::move(json)) {
+        _index(_ownedText.data(), _ownedText.data() + _ownedText.size());
+    }
+
+    /// @brief Unpack from the JSON text in the range [begin, end), which must
+    /// remain unchanged while the archive is in use.
+    Iarchive_json(const char * begin, const char * end) :
+        _ownedText() {
+        _index(begin, end);
+    }
+
+    /// @brief Unpack from the JSON text read from the given stream
+    /// @param is the stream from which to read JSON text holding an object
+    Iarchive_json(std::istream & is) :
+        _ownedText(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()) {
+        _index(_ownedText.data(), _ownedText.data() + _ownedText.size());
+    }
+
+    // default processing - kick back to our superclass
+    template<class T>
+    void load_override(T & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        boost::archive::detail::common_iarchive<Iarchive_json>::load_override(t ARCHIVE_XMLRPC_C_PFTO_ARG);
+    }
+
+    // Get class version number from special key "class_version"
+    void load_override(boost::archive::version_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        t = boost::archive::version_type(static_cast<int>(_parseInteger(_member("class_version"),
+                                                                        "class_version")));
+    }
+
+    // Don't bother loading tracking_type and class_id_optional_type Boost
+    // special values
+    void load_override(boost::archive::tracking_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+    void load_override(boost::archive::class_id_optional_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+
+    // Template load_override implementation for boost::serialization:nvp<T>
+    // when T is an enumerated type
+    template <typename T>
+    void nvp_load_override(const boost::serialization::nvp<T> & pair,
+                           std::true_type is_enum,
+                           std::false_type is_class,
+                           std::false_type is_integral
+                          ) {
+        const char * key = pair.name();
+        long long intVal = _parseInteger(_member(key), key);
+        _checkRange<int32_t>(intVal, key);
+        pair.value() = static_cast<T>(intVal);
+    }
+
+    // Template load_override implementation for boost::serialization:nvp<T>
+    // when T is a class with a serialize() method. The member is loaded in
+    // place from a nested archive.
+    template <typename T>
+    void nvp_load_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::true_type is_class,
+                           std::false_type is_integral
+                          ) {
+        _readObject(_member(pair.name()), pair.value());
+    }
+
+    // Template load_override implementation for boost::serialization:nvp<T>
+    // when T is an integral type
+    template <typename T>
+    void nvp_load_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::false_type is_class,
+                           std::true_type is_integral
+                          ) {
+        typedef IntegralWire_xmlrpc_c<T> Wire;
+        const char * key = pair.name();
+        long long intVal = _parseInteger(_member(key), key);
+        _checkRange<typename Wire::type>(intVal, key);
+        pair.value() = Wire::decode(static_cast<typename Wire::type>(intVal));
+    }
+
+    // Template load_override for boost::serialization::nvp<T>
+    // (name/value pairs)
+    //
+    // This template uses one of the nvp_load_override specializations above,
+    // selected at compile time based on T's type traits
+    template<class T>
+    void load_override(const boost::serialization::nvp<T> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        nvp_load_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
+    }
+
+    // Loader for name-value pair with bool value
+    void load_override(const boost::serialization::nvp<bool> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        Span span = _member(key);
+        if (_spanIs(span, "true")) {
+            pair.value() = true;
+        } else if (_spanIs(span, "false")) {
+            pair.value() = false;
+        } else {
+            _throwBadValue(key, "boolean");
+        }
+    }
+
+    // Loader for name-value pair with double value
+    void load_override(const boost::serialization::nvp<double> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        pair.value() = _parseFloat(_member(key), key);
+    }
+
+    // Loader for name-value pair with float value
+    void load_override(const boost::serialization::nvp<float> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        pair.value() = static_cast<float>(_parseFloat(_member(key), key));
+    }
+
+    // Loader for name-value pair with std::string value
+    void load_override(const boost::serialization::nvp<std::string> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        _parseString(_member(key), key, pair.value());
+    }
+
+    // Loader for name-value pair with byte string value
+    void load_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        _parseBase64(_member(key), key, pair.value());
+    }
+
+    // Loader for name-value pair with LazyXmlrpcSerializable<T> value. There
+    // is no xmlrpc_c::value to defer decoding of, so the member is decoded
+    // immediately.
+    template<typename T>
+    void load_override(const boost::serialization::nvp<LazyXmlrpcSerializable<T>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        T t;
+        _readObject(_member(pair.name()), t);
+        pair.value() = t;
+    }
+
+    // Loader for name-value pair with SharedBuffer_xmlrpc_c<T> value
+    template<typename T>
+    void load_override(const boost::serialization::nvp<SharedBuffer_xmlrpc_c<T>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        T content;
+        _parseContent(_member(key), key, content);
+        pair.value() = SharedBuffer_xmlrpc_c<T>(std::move(content));
+    }
+
+    // Loader for name-value pair with ScaledFloat_xmlrpc_c value
+    template<typename Float, typename Step, typename Offset>
+    void load_override(const boost::serialization::nvp<ScaledFloat_xmlrpc_c<Float, Step, Offset>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        long long intVal = _parseInteger(_member(key), key);
+        _checkRange<int32_t>(intVal, key);
+        pair.value() = ScaledFloat_xmlrpc_c<Float, Step, Offset>::Encoding::decode(
+                static_cast<int32_t>(intVal));
+    }
+
+    // Loader for name-value pair with ScaledFloatArray_xmlrpc_c value
+    template<typename Float, typename Step, typename Offset>
+    void load_override(const boost::serialization::nvp<ScaledFloatArray_xmlrpc_c<Float, Step, Offset>> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        const char * key = pair.name();
+        std::vector<int32_t> wire;
+        _parseIntegerArray(_member(key), key, wire);
+        pair.value().resize(wire.size());
+        ScaledFloatArray_xmlrpc_c<Float, Step, Offset>::Encoding::decode(
+                wire.data(), pair.value().data(), wire.size());
+    }
+
+    // Not sure why we need this, but things won't compile without it...
+    template<class T>
+    void load(T & t) {
+        std::ostringstream ss;
+        ss << "Iarchive_json only deals with name-value pairs, \n" <<
+              "failed to load from (mangled) type: " <<
+              typeid(T).name() << "\n" <<
+              "\n(Try 'c++filt -t <type>' to demangle the type name.)";
+        throw(std::runtime_error(ss.str()));
+    }
+
+private:
+    // For boost::serialization, we must make our superclass our friend!
+    friend class boost::archive::detail::common_iarchive<Iarchive_json>;
+
+    // Range [first, second) of the JSON text holding a value
+    typedef std::pair<const char *, const char *> Span;
+
+    // Return the span of the named member's value, throwing if there is none
+    Span _member(const char * key) const {
+        std::map<std::string, Span>::const_iterator it = _members.find(key);
+        if (it == _members.end()) {
+            std::ostringstream ss;
+            ss << "JSON object does not contain requested key '" << key << "'";
+            throw(std::runtime_error(ss.str()));
+        }
+        return(it->second);
+    }
+
+    static void _throwBadValue(const char * key, const char * expected) {
+        std::ostringstream ss;
+        ss << "JSON value for key '" << key << "' is not a valid " << expected;
+        throw(std::runtime_error(ss.str()));
+    }
+
+    static void _throwMalformed(const char * where) {
+        std::ostringstream ss;
+        ss << "Malformed JSON object: " << where;
+        throw(std::runtime_error(ss.str()));
+    }
+
+    template<typename T>
+    static void _checkRange(long long value, const char * key) {
+        if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max()) {
+            _throwBadValue(key, sizeof(T) == 4 ? "32-bit integer" : "64-bit integer");
+        }
+    }
+
+    static bool _spanIs(const Span & span, const char * text) {
+        size_t len = std::strlen(text);
+        return(size_t(span.second - span.first) == len &&
+               std::memcmp(span.first, text, len) == 0);
+    }
+
+    static const char * _skipSpace(const char * p, const char * end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            p++;
+        }
+        return(p);
+    }
+
+    // Return a pointer just past the end of the string starting (with its
+    // opening quote) at p
+    static const char * _skipString(const char * p, const char * end) {
+        for (p++; p < end; p++) {
+            if (*p == '\\') {
+                p++;
+            } else if (*p == '"') {
+                return(p + 1);
+            }
+        }
+        _throwMalformed("unterminated string");
+        return(end);
+    }
+
+    // Return a pointer just past the end of the value starting at p
+    static const char * _skipValue(const char * p, const char * end) {
+        if (p >= end) {
+            _throwMalformed("missing value");
+        }
+        if (*p == '"') {
+            return(_skipString(p, end));
+        }
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+            while (p < end) {
+                if (*p == '"') {
+                    p = _skipString(p, end);
+                    continue;
+                }
+                if (*p == '{' || *p == '[') {
+                    depth++;
+                } else if ((*p == '}' || *p == ']') && --depth == 0) {
+                    return(p + 1);
+                }
+                p++;
+            }
+            _throwMalformed("unterminated object or array");
+        }
+        // number, true, false or null
+        while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+               *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            p++;
+        }
+        return(p);
+    }
+
+    // Index the members of the JSON object in [begin, end)
+    void _index(const char * begin, const char * end) {
+        const char * p = _skipSpace(begin, end);
+        if (p >= end || *p != '{') {
+            _throwMalformed("text does not start with '{'");
+        }
+        p = _skipSpace(p + 1, end);
+        if (p < end && *p == '}') {
+            return;
+        }
+        while (true) {
+            if (p >= end || *p != '"') {
+                _throwMalformed("expected a quoted key");
+            }
+            const char * keyEnd = _skipString(p, end);
+            std::string key;
+            _unescape(p + 1, keyEnd - 1, key);
+            p = _skipSpace(keyEnd, end);
+            if (p >= end || *p != ':') {
+                _throwMalformed("expected ':' after key");
+            }
+            p = _skipSpace(p + 1, end);
+            const char * valueEnd = _skipValue(p, end);
+            _members[key] = Span(p, valueEnd);
+            p = _skipSpace(valueEnd, end);
+            if (p < end && *p == ',') {
+                p = _skipSpace(p + 1, end);
+            } else if (p < end && *p == '}') {
+                return;
+            } else {
+                _throwMalformed("expected ',' or '}' after value");
+            }
+        }
+    }
+
+    // Load a serializable object in place from the nested JSON object in the
+    // given span
+    template<typename T>
+    static void _readObject(const Span & span, T & t) {
+        Iarchive_json nestedIar(span.first, span.second);
+        nestedIar >> t;
+    }
+
+    // Parse a JSON array of 32-bit integers
+    static void _parseIntegerArray(const Span & span, const char * key,
+                                   std::vector<int32_t> & values) {
+        const char * p = span.first;
+        const char * end = span.second;
+        if (p >= end || *p != '[') {
+            _throwBadValue(key, "integer array");
+        }
+        values.clear();
+        p = _skipSpace(p + 1, end);
+        if (p < end && *p == ']') {
+            return;
+        }
+        while (true) {
+            const char * valueEnd = _skipValue(p, end);
+            long long intVal = _parseInteger(Span(p, valueEnd), key);
+            _checkRange<int32_t>(intVal, key);
+            values.push_back(static_cast<int32_t>(intVal));
+            p = _skipSpace(valueEnd, end);
+            if (p < end && *p == ',') {
+                p = _skipSpace(p + 1, end);
+            } else if (p < end && *p == ']') {
+                return;
+            } else {
+                _throwBadValue(key, "integer array");
+            }
+        }
+    }
+
+    static long long _parseInteger(const Span & span, const char * key) {
+        // Copy to a terminated buffer for strtoll
+        char buf[32];
+        size_t len = span.second - span.first;
+        if (len == 0 || len >= sizeof(buf)) {
+            _throwBadValue(key, "integer");
+        }
+        std::memcpy(buf, span.first, len);
+        buf[len] = '\0';
+        char * parseEnd;
+        errno = 0;
+        long long value = std::strtoll(buf, &parseEnd, 10);
+        if (parseEnd != buf + len || errno == ERANGE) {
+            _throwBadValue(key, "integer");
+        }
+        return(value);
+    }
+
+    static double _parseFloat(const Span & span, const char * key) {
+        if (_spanIs(span, "null")) {
+            return(std::numeric_limits<double>::quiet_NaN());
+        }
+        char buf[64];
+        size_t len = span.second - span.first;
+        if (len == 0 || len >= sizeof(buf)) {
+            _throwBadValue(key, "number");
+        }
+        std::memcpy(buf, span.first, len);
+        buf[len] = '\0';
+        char * parseEnd;
+        // Note that overflow (e.g., from 1e999) gives the infinity we want
+        double value = std::strtod(buf, &parseEnd);
+        if (parseEnd != buf + len) {
+            _throwBadValue(key, "number");
+        }
+        return(value);
+    }
+
+    static void _parseContent(const Span & span, const char * key, std::string & content) {
+        _parseString(span, key, content);
+    }
+    static void _parseContent(const Span & span, const char * key,
+                              std::vector<unsigned char> & content) {
+        _parseBase64(span, key, content);
+    }
+
+    static void _parseString(const Span & span, const char * key, std::string & str) {
+        if (span.second - span.first < 2 || *span.first != '"') {
+            _throwBadValue(key, "string");
+        }
+        str.clear();
+        _unescape(span.first + 1, span.second - 1, str);
+    }
+
+    // Append the UTF-8 encoding of the given code point to str
+    static void _appendUtf8(unsigned long cp, std::string & str) {
+        if (cp < 0x80) {
+            str.push_back(char(cp));
+        } else if (cp < 0x800) {
+            str.push_back(char(0xc0 | (cp >> 6)));
+            str.push_back(char(0x80 | (cp & 0x3f)));
+        } else if (cp < 0x10000) {
+            str.push_back(char(0xe0 | (cp >> 12)));
+            str.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+            str.push_back(char(0x80 | (cp & 0x3f)));
+        } else {
+            str.push_back(char(0xf0 | (cp >> 18)));
+            str.push_back(char(0x80 | ((cp >> 12) & 0x3f)));
+            str.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+            str.push_back(char(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    static unsigned long _parseHex4(const char * p, const char * end) {
+        if (end - p < 4) {
+            _throwMalformed("truncated \\u escape");
+        }
+        char hex[5] = { p[0], p[1], p[2], p[3], '\0' };
+        char * parseEnd;
+        unsigned long value = std::strtoul(hex, &parseEnd, 16);
+        if (parseEnd != hex + 4) {
+            _throwMalformed("bad \\u escape");
+        }
+        return(value);
+    }
+
+    // Append the unescaped content of the JSON string body in [p, end) to
+    // str. Runs of characters with no escapes are appended in one piece.
+    static void _unescape(const char * p, const char * end, std::string & str) {
+        str.reserve(str.size() + (end - p));
+        while (p < end) {
+            const char * runEnd = p;
+            while (runEnd < end && *runEnd != '\\') {
+                runEnd++;
+            }
+            str.append(p, runEnd);
+            p = runEnd;
+            if (p >= end) {
+                break;
+            }
+            // Escape sequence
+            if (++p >= end) {
+                _throwMalformed("truncated escape");
+            }
+            switch (*p++) {
+            case '"':  str.push_back('"'); break;
+            case '\\': str.push_back('\\'); break;
+            case '/':  str.push_back('/'); break;
+            case 'b':  str.push_back('\b'); break;
+            case 'f':  str.push_back('\f'); break;
+            case 'n':  str.push_back('\n'); break;
+            case 'r':  str.push_back('\r'); break;
+            case 't':  str.push_back('\t'); break;
+            case 'u': {
+                unsigned long cp = _parseHex4(p, end);
+                p += 4;
+                // Combine a UTF-16 surrogate pair
+                if (cp >= 0xd800 && cp < 0xdc00 && end - p >= 6 &&
+                    p[0] == '\\' && p[1] == 'u') {
+                    unsigned long low = _parseHex4(p + 2, end);
+                    if (low >= 0xdc00 && low < 0xe000) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                        p += 6;
+                    }
+                }
+                _appendUtf8(cp, str);
+                break;
+            }
+            default:
+                _throwMalformed("bad escape");
+            }
+        }
+    }
+
+    static void _parseBase64(const Span & span, const char * key,
+                             std::vector<unsigned char> & bytes) {
+        if (span.second - span.first < 2 || *span.first != '"') {
+            _throwBadValue(key, "base64 string");
+        }
+        bytes.clear();
+        bytes.reserve(((span.second - span.first) / 4) * 3);
+        unsigned long accum = 0;
+        int nBits = 0;
+        for (const char * p = span.first + 1; p < span.second - 1; p++) {
+            char c = *p;
+            int sextet;
+            if (c >= 'A' && c <= 'Z') {
+                sextet = c - 'A';
+            } else if (c >= 'a' && c <= 'z') {
+                sextet = c - 'a' + 26;
+            } else if (c >= '0' && c <= '9') {
+                sextet = c - '0' + 52;
+            } else if (c == '+') {
+                sextet = 62;
+            } else if (c == '/') {
+                sextet = 63;
+            } else if (c == '=') {
+                break;
+            } else {
+                _throwBadValue(key, "base64 string");
+                return;
+            }
+            accum = (accum << 6) | sextet;
+            nBits += 6;
+            if (nBits >= 8) {
+                nBits -= 8;
+                bytes.push_back((accum >> nBits) & 0xff);
+            }
+        }
+    }
+
+    /// Our own copy of the JSON text, if we were not given a range
+    const std::string _ownedText;
+    /// Map from member name to the span of its value in the JSON text
+    std::map<std::string, Span> _members;
+};
+
+BOOST_SERIALIZATION_REGISTER_ARCHIVE(Oarchive_json)
+BOOST_SERIALIZATION_REGISTER_ARCHIVE(Iarchive_json)
+
+#endif // ifndef _ARCHIVE_JSON_H_
@@ -29,14 +29,586 @@
  */
 #define BOOST_ARCHIVE_SOURCE
 
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <xmlrpc-c/base.h>
 #include <boost/version.hpp>
 #include "Archive_xmlrpc_c.h"
 
+// Instantiate the archive base classes and the SharedBuffer_xmlrpc_c types
+// here, once, for the extern template declarations in Archive_xmlrpc_c.h
+template class boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>;
+template class boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>;
+template class SharedBuffer_xmlrpc_c<std::string>;
+template class SharedBuffer_xmlrpc_c<std::vector<unsigned char>>;
+
 #if (BOOST_VERSION == 104100)
    // For Boost 1.41, we must explicitly instantiate some implementation for
    // this type of stream
 #  include <boost/archive/impl/archive_serializer_map.ipp>
-   template class boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>;
-   template class boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>;
    template class boost::archive::detail::archive_serializer_map<Iarchive_xmlrpc_c>;
 #endif
+
+KeyDictionary_xmlrpc_c::KeyDictionary_xmlrpc_c(const xmlrpc_c::value & names) {
+    std::vector<xmlrpc_c::value> nameVals =
+            xmlrpc_c::value_array(names).vectorValueValue();
+    for (size_t i = 0; i < nameVals.size(); i++) {
+        shortKey(static_cast<std::string>(xmlrpc_c::value_string(nameVals[i])));
+    }
+}
+
+const std::string &
+KeyDictionary_xmlrpc_c::shortKey(const std::string & name) {
+    std::map<std::string, std::string>::const_iterator it =
+            _shortKeys.find(name);
+    if (it == _shortKeys.end()) {
+        std::ostringstream ss;
+        ss << _names.size();
+        _names.push_back(name);
+        it = _shortKeys.insert(std::make_pair(name, ss.str())).first;
+    }
+    return(it->second);
+}
+
+const std::string *
+KeyDictionary_xmlrpc_c::findShortKey(const std::string & name) const {
+    std::map<std::string, std::string>::const_iterator it =
+            _shortKeys.find(name);
+    return(it == _shortKeys.end() ? 0 : &(it->second));
+}
+
+xmlrpc_c::value_array
+KeyDictionary_xmlrpc_c::toValueArray() const {
+    std::vector<xmlrpc_c::value> nameVals;
+    nameVals.reserve(_names.size());
+    for (size_t i = 0; i < _names.size(); i++) {
+        nameVals.push_back(xmlrpc_c::value_string(_names[i]));
+    }
+    return(xmlrpc_c::value_array(nameVals));
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::archive::version_type & t
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _dict["class_version"] = xmlrpc_c::value_int(static_cast<const int>(t));
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::serialization::nvp<bool> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    if (_defaults.isDefault(pair.value())) {
+        return;
+    }
+    _dict[_outputKey(pair.name())] = xmlrpc_c::value_boolean(pair.value());
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::serialization::nvp<double> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    if (_defaults.isDefault(pair.value())) {
+        return;
+    }
+    _dict[_outputKey(pair.name())] = xmlrpc_c::value_double(pair.value());
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::serialization::nvp<float> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    if (_defaults.isDefault(pair.value())) {
+        return;
+    }
+    _dict[_outputKey(pair.name())] = xmlrpc_c::value_double(pair.value());
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::serialization::nvp<std::string> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    if (_defaults.isDefault(pair.value())) {
+        return;
+    }
+    _dict[_outputKey(pair.name())] = xmlrpc_c::value_string(pair.value());
+}
+
+void
+Oarchive_xmlrpc_c::save_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    if (_defaults.isDefault(pair.value())) {
+        return;
+    }
+    _dict[_outputKey(pair.name())] = xmlrpc_c::value_bytestring(pair.value());
+}
+
+std::string
+Oarchive_xmlrpc_c::_outputKey(const std::string & name) {
+    return(_keyDict ? _keyDict->shortKey(name) : name);
+}
+
+void
+Oarchive_xmlrpc_c::_saveInteger(const char * name, int32_t value) {
+    _dict[_outputKey(name)] = xmlrpc_c::value_int(value);
+}
+
+void
+Oarchive_xmlrpc_c::_saveInteger(const char * name, int64_t value) {
+    _dict[_outputKey(name)] = xmlrpc_c::value_i8(value);
+}
+
+void
+Oarchive_xmlrpc_c::_saveIntegerArray(const char * name,
+                                     const std::vector<int32_t> & values) {
+    std::vector<xmlrpc_c::value> elements;
+    elements.reserve(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        elements.push_back(xmlrpc_c::value_int(values[i]));
+    }
+    _dict[_outputKey(name)] = xmlrpc_c::value_array(elements);
+}
+
+bool
+Oarchive_xmlrpc_c::_onlyClassVersion(const xmlrpc_c::value & structVal) {
+    const std::map<std::string, xmlrpc_c::value> dict =
+            xmlrpc_c::value_struct(structVal);
+    return(dict.size() == dict.count("class_version"));
+}
+
+Iarchive_xmlrpc_c::Iarchive_xmlrpc_c(const std::map<std::string, xmlrpc_c::value> & map,
+                                     const KeyDictionary_xmlrpc_c * keyDict,
+                                     unsigned int flags) :
+    _archiveMap(map),
+    _keyDict(keyDict),
+    _flags(flags),
+    _defaults() {}
+
+Iarchive_xmlrpc_c::Iarchive_xmlrpc_c(std::map<std::string, xmlrpc_c::value> && map,
+                                     const KeyDictionary_xmlrpc_c * keyDict,
+                                     unsigned int flags) :
+    _archiveMap(std::move(map)),
+    _keyDict(keyDict),
+    _flags(flags),
+    _defaults() {}
+
+Iarchive_xmlrpc_c::Iarchive_xmlrpc_c(const xmlrpc_c::value_struct & archive,
+                                     const KeyDictionary_xmlrpc_c * keyDict,
+                                     unsigned int flags) :
+    _archiveMap(static_cast<const std::map<std::string, xmlrpc_c::value>>(archive)),
+    _keyDict(keyDict),
+    _flags(flags),
+    _defaults() {}
+
+void
+Iarchive_xmlrpc_c::load_override(boost::archive::version_type & t
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    auto archiveIter = _archiveMap.find("class_version");
+    if (archiveIter == _archiveMap.end()) {
+        _throwMissingKey("class_version");
+    }
+    xmlrpc_c::value_int ival(archiveIter->second);
+    t = boost::archive::version_type(static_cast<int>(ival));
+}
+
+void
+Iarchive_xmlrpc_c::load_override(const boost::serialization::nvp<bool> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    auto archiveIter = _findMember(pair.name());
+    if (archiveIter == _archiveMap.end()) {
+        _loadMissing(pair.name(), pair.value());
+        return;
+    }
+    xmlrpc_c::value_boolean bval(archiveIter->second);
+    pair.value() = static_cast<bool>(bval);
+}
+
+void
+Iarchive_xmlrpc_c::load_override(const boost::serialization::nvp<double> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    double dval;
+    if (! _loadDouble(pair.name(), dval)) {
+        _loadMissing(pair.name(), pair.value());
+        return;
+    }
+    pair.value() = static_cast<double>(dval);
+}
+
+void
+Iarchive_xmlrpc_c::load_override(const boost::serialization::nvp<float> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    double dval;
+    if (! _loadDouble(pair.name(), dval)) {
+        _loadMissing(pair.name(), pair.value());
+        return;
+    }
+    pair.value() = static_cast<float>(dval);
+}
+
+void
+Iarchive_xmlrpc_c::load_override(const boost::serialization::nvp<std::string> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    auto archiveIter = _findMember(pair.name());
+    if (archiveIter == _archiveMap.end()) {
+        _loadMissing(pair.name(), pair.value());
+        return;
+    }
+    xmlrpc_c::value_string sval(archiveIter->second);
+    if (_flags & MergeIntoExisting_xmlrpc_c) {
+        // Copy into the member's existing buffer, which keeps its capacity
+        // if it is large enough, rather than replacing the buffer. The
+        // content is read with the C API, since value_string::cvalue() would
+        // make an extra copy of it in a temporary std::string.
+        xmlrpc_env env;
+        xmlrpc_env_init(&env);
+        xmlrpc_value * cValP = sval.cValue();
+        size_t length = 0;
+        const char * content = 0;
+        xmlrpc_read_string_lp(&env, cValP, &length, &content);
+        xmlrpc_DECREF(cValP);
+        if (env.fault_occurred) {
+            std::runtime_error error(env.fault_string);
+            xmlrpc_env_clean(&env);
+            throw(error);
+        }
+        pair.value().assign(content, length);
+        xmlrpc_strfree(content);
+        xmlrpc_env_clean(&env);
+        return;
+    }
+    pair.value() = static_cast<std::string>(sval);
+}
+
+void
+Iarchive_xmlrpc_c::load_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                                 ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    auto archiveIter = _findMember(pair.name());
+    if (archiveIter == _archiveMap.end()) {
+        _loadMissing(pair.name(), pair.value());
+        return;
+    }
+    xmlrpc_c::value_bytestring bval(archiveIter->second);
+    if (_flags & MergeIntoExisting_xmlrpc_c) {
+        // Copy into the member's existing buffer, reading the content with
+        // the C API as for std::string above
+        xmlrpc_env env;
+        xmlrpc_env_init(&env);
+        xmlrpc_value * cValP = bval.cValue();
+        size_t length = 0;
+        const unsigned char * content = 0;
+        xmlrpc_read_base64(&env, cValP, &length, &content);
+        xmlrpc_DECREF(cValP);
+        if (env.fault_occurred) {
+            std::runtime_error error(env.fault_string);
+            xmlrpc_env_clean(&env);
+            throw(error);
+        }
+        pair.value().assign(content, content + length);
+        std::free(const_cast<unsigned char *>(content));
+        xmlrpc_env_clean(&env);
+        return;
+    }
+    // Move the (single) copy of the bytes into the member
+    pair.value() = bval.vectorUcharValue();
+}
+
+std::map<std::string, xmlrpc_c::value>::const_iterator
+Iarchive_xmlrpc_c::_findMember(const std::string & name) const {
+    if (! _keyDict) {
+        return(_archiveMap.find(name));
+    }
+    const std::string * shortKey = _keyDict->findShortKey(name);
+    return(_archiveMap.find(shortKey ? *shortKey : name));
+}
+
+// Convert v to the archive representation W of an integral member whose
+// range is [memberMin, memberMax], returning false if v is out of range.
+// Values in the member's range are taken as they are, and unsigned members
+// as wide as W also take W's negative values, as the bitwise-equivalent
+// signed values of the upper half of their range (see
+// IntegralWire_xmlrpc_c).
+template<typename W>
+static bool
+wireFromInteger(int64_t v, int64_t memberMin, uint64_t memberMax, W & wire) {
+    typedef typename std::make_unsigned<W>::type U;
+    if (v < 0 ? v >= memberMin : static_cast<uint64_t>(v) <= memberMax) {
+        if (v <= std::numeric_limits<W>::max()) {
+            wire = static_cast<W>(v);
+        } else {
+            // Only possible for unsigned members as wide as W
+            wire = IntegralWire_xmlrpc_c<U>::encode(static_cast<U>(v));
+        }
+        return(true);
+    }
+    if (memberMin == 0 && memberMax == std::numeric_limits<U>::max() &&
+        v >= std::numeric_limits<W>::min()) {
+        wire = static_cast<W>(v);
+        return(true);
+    }
+    return(false);
+}
+
+// As above, for a double which must hold a whole number
+template<typename W>
+static bool
+wireFromDouble(double v, int64_t memberMin, uint64_t memberMax, W & wire) {
+    typedef typename std::make_unsigned<W>::type U;
+    if (! std::isfinite(v) || std::trunc(v) != v) {
+        return(false);
+    }
+    // The limits are powers of two or one less, so these are exact as
+    // doubles: the member holds [memberMin, memberEnd) and W holds
+    // [wireMin, -wireMin).
+    const double memberEnd = 2.0 * static_cast<double>(memberMax / 2 + 1);
+    const double wireMin = static_cast<double>(std::numeric_limits<W>::min());
+    if (v >= static_cast<double>(memberMin) && v < memberEnd) {
+        if (v < -wireMin) {
+            wire = static_cast<W>(v);
+        } else {
+            // Only possible for unsigned members as wide as W
+            wire = IntegralWire_xmlrpc_c<U>::encode(static_cast<U>(v));
+        }
+        return(true);
+    }
+    if (memberMin == 0 && memberMax == std::numeric_limits<U>::max() &&
+        v >= wireMin) {
+        wire = static_cast<W>(v);
+        return(true);
+    }
+    return(false);
+}
+
+// Coerce val, which is not of the type expected for an integral member with
+// range [memberMin, memberMax], to the member's archive representation W if
+// flags allow. If they don't, construct the expected type from val to raise
+// the usual xmlrpc-c type error.
+template<typename W>
+static void
+coerceInteger(const char * name, const xmlrpc_c::value & val, unsigned int flags,
+              int64_t memberMin, uint64_t memberMax, W & wire) {
+    bool allowed = false;
+    bool inRange = false;
+    switch (val.type()) {
+    case xmlrpc_c::value::TYPE_INT:
+        allowed = flags & CoerceIntegerWidth_xmlrpc_c;
+        inRange = allowed &&
+                wireFromInteger(xmlrpc_c::value_int(val).cvalue(), memberMin, memberMax, wire);
+        break;
+    case xmlrpc_c::value::TYPE_I8:
+        allowed = flags & CoerceIntegerWidth_xmlrpc_c;
+        inRange = allowed &&
+                wireFromInteger(xmlrpc_c::value_i8(val).cvalue(), memberMin, memberMax, wire);
+        break;
+    case xmlrpc_c::value::TYPE_DOUBLE:
+        allowed = flags & CoerceDoubleToInteger_xmlrpc_c;
+        inRange = allowed &&
+                wireFromDouble(xmlrpc_c::value_double(val).cvalue(), memberMin, memberMax, wire);
+        break;
+    default:
+        break;
+    }
+    if (inRange) {
+        return;
+    }
+    if (allowed) {
+        std::ostringstream ss;
+        ss << "xmlrpc_c::value_struct value for key '" << name <<
+              "' is out of range for its integral member";
+        throw(std::runtime_error(ss.str()));
+    }
+    if (sizeof(W) <= 4) {
+        xmlrpc_c::value_int checked(val);
+    } else {
+        xmlrpc_c::value_i8 checked(val);
+    }
+}
+
+bool
+Iarchive_xmlrpc_c::_loadInteger(const char * name, int32_t & value,
+                                int64_t memberMin, uint64_t memberMax) const {
+    auto archiveIter = _findMember(name);
+    if (archiveIter == _archiveMap.end()) {
+        return(false);
+    }
+    const xmlrpc_c::value & val = archiveIter->second;
+    if (val.type() == xmlrpc_c::value::TYPE_INT) {
+        value = xmlrpc_c::value_int(val).cvalue();
+    } else {
+        coerceInteger(name, val, _flags, memberMin, memberMax, value);
+    }
+    return(true);
+}
+
+bool
+Iarchive_xmlrpc_c::_loadInteger(const char * name, int64_t & value,
+                                int64_t memberMin, uint64_t memberMax) const {
+    auto archiveIter = _findMember(name);
+    if (archiveIter == _archiveMap.end()) {
+        return(false);
+    }
+    const xmlrpc_c::value & val = archiveIter->second;
+    if (val.type() == xmlrpc_c::value::TYPE_I8) {
+        value = xmlrpc_c::value_i8(val).cvalue();
+    } else {
+        coerceInteger(name, val, _flags, memberMin, memberMax, value);
+    }
+    return(true);
+}
+
+bool
+Iarchive_xmlrpc_c::_loadIntegerArray(const char * name,
+                                     std::vector<int32_t> & values) const {
+    auto archiveIter = _findMember(name);
+    if (archiveIter == _archiveMap.end()) {
+        return(false);
+    }
+    std::vector<xmlrpc_c::value> elements =
+            xmlrpc_c::value_array(archiveIter->second).vectorValueValue();
+    values.resize(elements.size());
+    for (size_t i = 0; i < elements.size(); i++) {
+        const xmlrpc_c::value & val = elements[i];
+        if (val.type() == xmlrpc_c::value::TYPE_INT) {
+            values[i] = xmlrpc_c::value_int(val).cvalue();
+        } else {
+            coerceInteger(name, val, _flags, std::numeric_limits<int32_t>::min(),
+                          std::numeric_limits<int32_t>::max(), values[i]);
+        }
+    }
+    return(true);
+}
+
+bool
+Iarchive_xmlrpc_c::_loadDouble(const char * name, double & value) const {
+    auto archiveIter = _findMember(name);
+    if (archiveIter == _archiveMap.end()) {
+        return(false);
+    }
+    const xmlrpc_c::value & val = archiveIter->second;
+    xmlrpc_c::value::type_t type = val.type();
+    if ((_flags & CoerceIntegerToDouble_xmlrpc_c) &&
+        type == xmlrpc_c::value::TYPE_INT) {
+        value = xmlrpc_c::value_int(val).cvalue();
+    } else if ((_flags & CoerceIntegerToDouble_xmlrpc_c) &&
+               type == xmlrpc_c::value::TYPE_I8) {
+        value = static_cast<double>(xmlrpc_c::value_i8(val).cvalue());
+    } else {
+        // Throws the usual xmlrpc-c type error if val is not a value_double
+        value = xmlrpc_c::value_double(val).cvalue();
+    }
+    return(true);
+}
+
+void
+Iarchive_xmlrpc_c::_throwMissingKey(const std::string & name) {
+    std::ostringstream ss;
+    ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
+          name << "'";
+    throw(std::runtime_error(ss.str()));
+}
+
+// Return the key under which the named member is archived
+static const std::string &
+archivedKey(const std::string & name, const KeyDictionary_xmlrpc_c * keyDict) {
+    const std::string * shortKey = keyDict ? keyDict->findShortKey(name) : 0;
+    return(shortKey ? *shortKey : name);
+}
+
+Migration_xmlrpc_c &
+Migration_xmlrpc_c::rename(const std::string & oldName,
+                           const std::string & newName) {
+    Step step = { Step::Rename, oldName, newName, xmlrpc_c::value(), Transform() };
+    _steps.push_back(step);
+    return(*this);
+}
+
+Migration_xmlrpc_c &
+Migration_xmlrpc_c::setDefault(const std::string & name,
+                               const xmlrpc_c::value & value) {
+    Step step = { Step::SetDefault, name, std::string(), value, Transform() };
+    _steps.push_back(step);
+    return(*this);
+}
+
+Migration_xmlrpc_c &
+Migration_xmlrpc_c::drop(const std::string & name) {
+    Step step = { Step::Drop, name, std::string(), xmlrpc_c::value(), Transform() };
+    _steps.push_back(step);
+    return(*this);
+}
+
+Migration_xmlrpc_c &
+Migration_xmlrpc_c::transform(const std::string & name, Transform fn) {
+    Step step = { Step::TransformValue, name, std::string(), xmlrpc_c::value(), fn };
+    _steps.push_back(step);
+    return(*this);
+}
+
+// Set the given dictionary entry, replacing any existing one. xmlrpc-c does
+// not allow assignment to an xmlrpc_c::value which already holds a value, so
+// an existing entry is erased rather than assigned over.
+static void
+replaceEntry(std::map<std::string, xmlrpc_c::value> & dict,
+             const std::string & key, const xmlrpc_c::value & value) {
+    dict.erase(key);
+    dict.insert(std::make_pair(key, value));
+}
+
+void
+Migration_xmlrpc_c::apply(std::map<std::string, xmlrpc_c::value> & dict,
+                          const KeyDictionary_xmlrpc_c * keyDict) const {
+    for (size_t i = 0; i < _steps.size(); i++) {
+        const Step & step = _steps[i];
+        std::map<std::string, xmlrpc_c::value>::iterator it =
+                dict.find(archivedKey(step.name, keyDict));
+        switch (step.kind) {
+        case Step::Rename:
+            if (it != dict.end()) {
+                xmlrpc_c::value val = it->second;
+                dict.erase(it);
+                replaceEntry(dict, archivedKey(step.newName, keyDict), val);
+            }
+            break;
+        case Step::SetDefault:
+            if (it == dict.end()) {
+                dict.insert(std::make_pair(archivedKey(step.name, keyDict),
+                                           step.value));
+            }
+            break;
+        case Step::Drop:
+            if (it != dict.end()) {
+                dict.erase(it);
+            }
+            break;
+        case Step::TransformValue:
+            if (it != dict.end()) {
+                xmlrpc_c::value val = step.fn(it->second);
+                const std::string key = it->first;
+                dict.erase(it);
+                replaceEntry(dict, key, val);
+            }
+            break;
+        }
+    }
+}
+
+void
+Migration_xmlrpc_c::upgrade(std::map<std::string, xmlrpc_c::value> & dict,
+                            const KeyDictionary_xmlrpc_c * keyDict,
+                            const std::map<unsigned int, Migration_xmlrpc_c> & migrations,
+                            unsigned int currentVersion) {
+    // Leave anything without a usable class_version to the archive, which
+    // reports the problem when it loads the version.
+    std::map<std::string, xmlrpc_c::value>::iterator versionIter =
+            dict.find("class_version");
+    if (versionIter == dict.end() ||
+        versionIter->second.type() != xmlrpc_c::value::TYPE_INT) {
+        return;
+    }
+    int version = xmlrpc_c::value_int(versionIter->second);
+    if (version < 0 || static_cast<unsigned int>(version) >= currentVersion) {
+        return;
+    }
+    std::map<unsigned int, Migration_xmlrpc_c>::const_iterator it =
+            migrations.lower_bound(version);
+    for (; it != migrations.end() && it->first < currentVersion; ++it) {
+        it->second.apply(dict, keyDict);
+    }
+    replaceEntry(dict, "class_version", xmlrpc_c::value_int(currentVersion));
+}
+
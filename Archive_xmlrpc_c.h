@@ -25,19 +25,312 @@
 #ifndef _ARCHIVE_XMLRPC_C_H_
 #define _ARCHIVE_XMLRPC_C_H_
 
+#include <cstring>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ratio>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <xmlrpc-c/base.hpp>
 #include <boost/archive/detail/common_iarchive.hpp>
 #include <boost/archive/detail/common_oarchive.hpp>
 #include <boost/archive/detail/register_archive.hpp>
+#include <boost/serialization/version.hpp>
 
 using namespace xmlrpc_c;
 
-// Template forward reference
+// Boost versions which define BOOST_PFTO pass an extra (ignored) int argument
+// to save_override() and load_override(). These macros supply the extra
+// parameter in override declarations, and the extra argument when passing
+// calls on to the superclass.
+#ifdef BOOST_PFTO
+#  define ARCHIVE_XMLRPC_C_PFTO_PARAM , BOOST_PFTO int
+#  define ARCHIVE_XMLRPC_C_PFTO_ARG , 0
+#else
+#  define ARCHIVE_XMLRPC_C_PFTO_PARAM
+#  define ARCHIVE_XMLRPC_C_PFTO_ARG
+#endif
+
+class KeyDictionary_xmlrpc_c;
+
+// Thread safety
+//
+// Any number of threads may save and load objects of the same or different
+// types at once, each with its own archive, without locking: the archives
+// keep all of their state in the archive object, and the state they share
+// (the Boost serializer singletons, the DefaultInstance_xmlrpc_c<T>() objects
+// and the Migrations_xmlrpc_c<T> registries) is created during static
+// initialization or on first use, and only read after that. The remaining
+// rules are those of the standard containers:
+//
+// - an archive object must be used by one thread at a time;
+// - objects being saved, and const KeyDictionary_xmlrpc_c and xmlrpc_c::value
+//   objects being loaded from, may be shared between threads;
+// - an object being loaded into, or a KeyDictionary_xmlrpc_c being saved
+//   with (which adds names to it), must not be used by any other thread;
+// - Migrations_xmlrpc_c<T> must be registered before any thread loads a T,
+//   e.g., before the loading threads are started. Registering after a load
+//   throws, but that check is best-effort: a registration racing with
+//   another thread's first load may not be caught, and is a data race.
+//
+// LazyXmlrpcSerializable<T> and SharedBuffer_xmlrpc_c<T> members, which
+// decode on first access, do so safely from concurrent const accessors.
+// xmlrpc-c must be built with thread support (the default), since threads
+// sharing an xmlrpc_c::value update its reference count concurrently.
+// stressArchive tests these guarantees, and under ThreadSanitizer when built
+// with "scons tsan=1".
+
+// Template forward references
 template<typename T> class XmlrpcSerializable;
+template<typename T> class LazyXmlrpcSerializable;
+template<typename T> class SharedBuffer_xmlrpc_c;
+template<typename Float, typename Step, typename Offset> class ScaledFloat_xmlrpc_c;
+template<typename Float, typename Step, typename Offset> class ScaledFloatArray_xmlrpc_c;
+template<typename T>
+void mergeInto_xmlrpc_c(T & obj, const xmlrpc_c::value & xmlrpcVal,
+                        const KeyDictionary_xmlrpc_c * keyDict = 0,
+                        unsigned int flags = 0);
+
+/// @brief Dictionary of member names used for compact-key archiving
+///
+/// When a KeyDictionary_xmlrpc_c is given to Oarchive_xmlrpc_c, each member
+/// name is replaced in the output dictionary by a short numeric key ("0",
+/// "1", ...) assigned the first time the name is seen. The same
+/// KeyDictionary_xmlrpc_c may be (and generally should be) shared across all
+/// of the objects in a message, e.g., all of the elements of an array of
+/// structs, so that the full names are sent only once.
+///
+/// The dictionary is sent to the peer as the xmlrpc_c::value_array returned
+/// by toValueArray(), and the peer reconstructs it and hands it to
+/// Iarchive_xmlrpc_c, which then expands the short keys transparently.
+/// Archives created without a KeyDictionary_xmlrpc_c use plain member names,
+/// and remain compatible with peers which know nothing of compact keys.
+///
+/// The special "class_version" key is never compacted.
+///
+/// A dictionary may be read by any number of threads, e.g., to load, but
+/// saving adds names to it, so a dictionary being saved with must not be used
+/// by other threads.
+class KeyDictionary_xmlrpc_c {
+public:
+    /// @brief Construct an empty dictionary
+    KeyDictionary_xmlrpc_c() {}
+
+    /// @brief Construct from the xmlrpc_c::value_array generated by a peer's
+    /// toValueArray()
+    /// @param names the xmlrpc_c::value (which must be xmlrpc_c::value_array)
+    /// holding the member names
+    KeyDictionary_xmlrpc_c(const xmlrpc_c::value & names);
+
+    /// @brief Return the short key for the given member name, adding the
+    /// name to the dictionary if it is not already there.
+    /// @param name the member name
+    /// @return the short key for the given member name
+    const std::string & shortKey(const std::string & name);
+
+    /// @brief Return a pointer to the short key for the given member name,
+    /// or null if the name is not in the dictionary.
+    /// @param name the member name
+    /// @return a pointer to the short key for the given member name, or null
+    /// if the name is not in the dictionary.
+    const std::string * findShortKey(const std::string & name) const;
+
+    /// @brief Return the number of names in the dictionary
+    size_t size() const { return(_names.size()); }
+
+    /// @brief Return the dictionary as an xmlrpc_c::value_array of member
+    /// names, where the index of each name is its short key.
+    xmlrpc_c::value_array toValueArray() const;
+
+private:
+    /// Member names, in order of short key
+    std::vector<std::string> _names;
+    /// Map from member name to short key
+    std::map<std::string, std::string> _shortKeys;
+};
+
+/// @brief Signed integer representation used when archiving integral type T
+///
+/// Integral types of 4 bytes or less are archived as 32-bit signed integers,
+/// and larger ones as 64-bit signed integers. Unsigned values are archived as
+/// their bitwise-equivalent signed value, and are reinterpreted the other way
+/// when loaded, so that the full unsigned range survives the trip.
+template<typename T>
+struct IntegralWire_xmlrpc_c {
+    /// The signed type used to archive a T
+    typedef typename std::conditional<(sizeof(T) <= 4), int32_t, int64_t>::type type;
+
+    /// @brief Return the archived representation of the given value
+    static type encode(T value) {
+        return(_encode(value, std::is_signed<T>()));
+    }
+
+    /// @brief Return the value for the given archived representation
+    static T decode(type wireValue) {
+        return(_decode(wireValue, std::is_signed<T>()));
+    }
+
+private:
+    typedef typename std::make_unsigned<type>::type _utype;
+
+    static type _encode(T value, std::true_type) { return(value); }
+    static type _encode(T value, std::false_type) {
+        _utype unsignedVal = value;
+        type signedBitwiseEquiv;
+        std::memcpy(&signedBitwiseEquiv, &unsignedVal, sizeof(type));
+        return(signedBitwiseEquiv);
+    }
+
+    static T _decode(type wireValue, std::true_type) { return(wireValue); }
+    static T _decode(type wireValue, std::false_type) {
+        _utype unsignedVal;
+        std::memcpy(&unsignedVal, &wireValue, sizeof(type));
+        return(unsignedVal);
+    }
+};
+
+/// @brief Flags which may be or-ed together and passed to the
+/// Oarchive_xmlrpc_c and Iarchive_xmlrpc_c constructors
+enum ArchiveFlags_xmlrpc_c {
+    /// On save, omit members whose value equals their value in a
+    /// default-constructed instance of the enclosing class. Members which are
+    /// themselves serializable classes are saved with the same flags, and
+    /// omitted entirely if all of their members are omitted. On load, members
+    /// missing from the dictionary are set from the default-constructed
+    /// instance rather than causing an exception.
+    ElideDefaults_xmlrpc_c = 0x01,
+    /// On load, accept xmlrpc_c::value_i8 for integral members archived as
+    /// xmlrpc_c::value_int (4 bytes or smaller) and vice versa, if the value
+    /// is in the range of the member's own type; values out of range throw.
+    /// Unsigned 32- and 64-bit members also accept the bitwise-equivalent
+    /// negative values they are archived as.
+    CoerceIntegerWidth_xmlrpc_c = 0x02,
+    /// On load, accept xmlrpc_c::value_int and xmlrpc_c::value_i8 for
+    /// double and float members.
+    CoerceIntegerToDouble_xmlrpc_c = 0x04,
+    /// On load, accept xmlrpc_c::value_double for integral members if it
+    /// holds a whole number in the range of the member's own type (as for
+    /// CoerceIntegerWidth_xmlrpc_c).
+    CoerceDoubleToInteger_xmlrpc_c = 0x08,
+    /// All of the numeric coercions above, e.g., for peers written in
+    /// languages which do not distinguish integer widths.
+    CoerceNumbers_xmlrpc_c = 0x0e,
+    /// On load, update the existing object in place rather than replacing
+    /// it: members missing from the dictionary are left unchanged (taking
+    /// precedence over ElideDefaults_xmlrpc_c), nested classes are loaded
+    /// member by member, and strings and byte strings are copied into their
+    /// existing buffers so that they keep their capacity. See
+    /// mergeInto_xmlrpc_c().
+    MergeIntoExisting_xmlrpc_c = 0x10
+};
+
+/// @brief Return a default-constructed instance of T, which is created the
+/// first time it is requested and shared thereafter.
+template<typename T>
+const T & DefaultInstance_xmlrpc_c() {
+    static const T instance{};
+    return(instance);
+}
+
+/// @brief Tracks the object an archive is currently saving or loading and a
+/// default-constructed instance of the same type, so that members of the
+/// object can be matched with their default values for ElideDefaults_xmlrpc_c.
+///
+/// Since both objects are of the same type, a member's default is found at
+/// the same offset in the default instance as the member is in the object.
+class DefaultScope_xmlrpc_c {
+public:
+    DefaultScope_xmlrpc_c() : _objBase(0), _objSize(0), _defaultBase(0) {}
+
+    /// @brief Guard which, if enabled, sets the scope to the given object for
+    /// its lifetime (defined below)
+    class Guard;
+
+    /// @brief Return a pointer to the default value of the given member of
+    /// the current object, or null if there is no current object or the
+    /// member is not part of it.
+    template<typename M>
+    const M * defaultMember(const M & member) const {
+        if (! _defaultBase) {
+            return(0);
+        }
+        const char * memberPtr = reinterpret_cast<const char *>(&member);
+        std::less<const char *> before;
+        if (before(memberPtr, _objBase) ||
+            before(_objBase + _objSize, memberPtr + sizeof(M))) {
+            return(0);
+        }
+        return(reinterpret_cast<const M *>(_defaultBase + (memberPtr - _objBase)));
+    }
+
+    /// @brief Return true iff the member of the current object equals its
+    /// default value.
+    template<typename M>
+    bool isDefault(const M & member) const {
+        const M * dflt = defaultMember(member);
+        return(dflt && _sameValue(*dflt, member));
+    }
+
+private:
+    template<typename T>
+    void _set(const T & t, std::true_type) {
+        _objBase = reinterpret_cast<const char *>(&t);
+        _objSize = sizeof(T);
+        _defaultBase = reinterpret_cast<const char *>(&DefaultInstance_xmlrpc_c<T>());
+    }
+    template<typename T>
+    void _set(const T &, std::false_type) {
+        _objBase = 0;
+        _objSize = 0;
+        _defaultBase = 0;
+    }
+
+    template<typename M>
+    static bool _sameValue(const M & a, const M & b) { return(a == b); }
+    // Compare floating point values bitwise, so that e.g. -0.0 is not
+    // mistaken for a default of 0.0
+    static bool _sameValue(const double & a, const double & b) {
+        return(std::memcmp(&a, &b, sizeof(a)) == 0);
+    }
+    static bool _sameValue(const float & a, const float & b) {
+        return(std::memcmp(&a, &b, sizeof(a)) == 0);
+    }
+
+    const char * _objBase;
+    size_t _objSize;
+    const char * _defaultBase;
+};
+
+/// @brief Guard which, if enabled, sets a DefaultScope_xmlrpc_c to the given
+/// object for its lifetime, restoring the previous scope on destruction. The
+/// scope is unset for objects which are not of default-constructible class
+/// type.
+class DefaultScope_xmlrpc_c::Guard {
+public:
+    template<typename T>
+    Guard(DefaultScope_xmlrpc_c & scope, const T & t, bool enable) :
+        _scope(scope),
+        _saved(scope) {
+        if (enable) {
+            _scope._set(t, std::integral_constant<bool,
+                    std::is_class<T>::value &&
+                    std::is_default_constructible<T>::value>());
+        }
+    }
+    ~Guard() { _scope = _saved; }
+private:
+    DefaultScope_xmlrpc_c & _scope;
+    DefaultScope_xmlrpc_c _saved;
+};
 
 /// @brief Boost output archive class to populate an xmlrpc_c::value_struct
 /// dictionary
@@ -84,29 +377,35 @@ class Oarchive_xmlrpc_c :
 public:
     /// @brief Archive to the given dictionary mapping string keys to
     /// xmlrpc_c::value objects.
-    Oarchive_xmlrpc_c(std::map<std::string, xmlrpc_c::value> & dict) :
-    	_dict(dict) {}
+    /// @param dict the dictionary to populate
+    /// @param keyDict if non-null, member names are replaced by short keys
+    /// from (and added to) this KeyDictionary_xmlrpc_c
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    Oarchive_xmlrpc_c(std::map<std::string, xmlrpc_c::value> & dict,
+                      KeyDictionary_xmlrpc_c * keyDict = 0,
+                      unsigned int flags = 0) :
+    	_dict(dict),
+    	_keyDict(keyDict),
+    	_flags(flags),
+    	_defaults() {}
 
-#ifdef BOOST_PFTO
     // default processing - kick back to our superclass
     template<class T>
-    void save_override(const T & t, BOOST_PFTO int) {
-        boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>::save_override(t, 0);
+    void save_override(const T & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        // Note where the object and a default instance of its type live while
+        // saving, so that its members can be compared to their defaults.
+        DefaultScope_xmlrpc_c::Guard defaultGuard(_defaults, t,
+                                                  _flags & ElideDefaults_xmlrpc_c);
+        boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>::save_override(t ARCHIVE_XMLRPC_C_PFTO_ARG);
     }
 
     // Add special key "class_version" in the dictionary to hold the version
     // number of the class we're archiving.
-    void save_override(const boost::archive::version_type & t, BOOST_PFTO int) {
-        _dict["class_version"] = xmlrpc_c::value_int(static_cast<const int>(t));
-    }
+    void save_override(const boost::archive::version_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // Don't bother archiving tracking_type, class_id_optional_type Boost special values
-    void save_override(const boost::archive::tracking_type & t, BOOST_PFTO int) {
-//        std::cerr << "Oarchive_xmlrpc_c dropping tracking_type" << std::endl;
-    }
-    void save_override(const boost::archive::class_id_optional_type & t, BOOST_PFTO int) {
-//        std::cerr << "Oarchive_xmlrpc_c dropping class_id_optional_type" << std::endl;
-    }
+    void save_override(const boost::archive::tracking_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+    void save_override(const boost::archive::class_id_optional_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
 
     // Template save_override implementation for boost::serialization:nvp<T>
     // when T is an enumerated type
@@ -116,8 +415,10 @@ public:
                             std::false_type is_class,
                             std::false_type is_integral
                            ) {
-        const char * key = pair.name();
-        _dict[key] = xmlrpc_c::value_int(int(pair.value()));
+        if (_defaults.isDefault(pair.value())) {
+            return;
+        }
+        _saveInteger(pair.name(), int32_t(int(pair.value())));
     }
 
     // Template save_override implementation for boost::serialization:nvp<T>
@@ -130,7 +431,16 @@ public:
                            ) {
         const char * key = pair.name();
         XmlrpcSerializable<T> sValue(pair.value());
-        _dict[key] = sValue;
+        std::map<std::string, xmlrpc_c::value> nestedDict;
+        Oarchive_xmlrpc_c nestedOar(nestedDict, _keyDict, _flags);
+        nestedOar << sValue;
+        // When eliding defaults, skip the member entirely if nothing but its
+        // class_version was written.
+        if ((_flags & ElideDefaults_xmlrpc_c) &&
+            nestedDict.size() == nestedDict.count("class_version")) {
+            return;
+        }
+        _dict[_outputKey(key)] = xmlrpc_c::value_struct(nestedDict);
     }
 
     // Template save_override implementation for boost::serialization:nvp<T>
@@ -141,35 +451,13 @@ public:
                             std::false_type is_class,
                             std::true_type is_integral
                            ) {
-        const char * key = pair.name();
-        xmlrpc_c::value xmlrpcval;
-        // Split handling. 32-bit and smaller integers are saved as 32-bit
-        // values. Bigger integers are saved as 64-bit values.
-        if (sizeof(T) <= 4) {
-            // For signed integer values, save as xmlrpc_c::value_int (32 bit)
-            //
-            // For unsigned values, save as their bitwise-equivalent 32-bit
-            // signed int. They will be reinterpreted the other way when
-            // loaded again.
-            if (std::is_signed<T>::value) {
-                xmlrpcval = xmlrpc_c::value_int(pair.value());
-            } else {
-                uint32_t unsignedVal = pair.value();
-                int32_t signedBitwiseEquiv(*reinterpret_cast<int32_t*>(&unsignedVal));
-                xmlrpcval = xmlrpc_c::value_int(signedBitwiseEquiv);
-            }
-        } else {
-            // Similar to above, but we save as 8-byte (64-bit) type
-            // xmlrpc_c::value_i8
-            if (std::is_signed<T>::value) {
-                xmlrpcval = xmlrpc_c::value_i8(pair.value());
-            } else {
-                uint64_t unsignedVal = pair.value();
-                int64_t signedBitwiseEquiv(*reinterpret_cast<int64_t*>(&unsignedVal));
-                xmlrpcval = xmlrpc_c::value_i8(signedBitwiseEquiv);
-            }
+        if (_defaults.isDefault(pair.value())) {
+            return;
         }
-        _dict[key] = xmlrpcval;
+        // Unsigned values are saved as their bitwise-equivalent signed value,
+        // and the size of the wire type selects 32-bit xmlrpc_c::value_int or
+        // 64-bit xmlrpc_c::value_i8 (see IntegralWire_xmlrpc_c).
+        _saveInteger(pair.name(), IntegralWire_xmlrpc_c<T>::encode(pair.value()));
     }
 
     // Template save_override for boost::serialization::nvp<T>
@@ -178,149 +466,76 @@ public:
     // This template uses one of the nvp_save_override specializations above,
     // selected at compile time based on T's type traits
     template<typename T>
-    void save_override(const boost::serialization::nvp<T> & pair,
-                       BOOST_PFTO int) {
+    void save_override(const boost::serialization::nvp<T> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
         // Select implementation at compile time depending on whether T is an
         // enumerated type or a class
         nvp_save_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
     }
 
     // name-value pair handling for bool values
-    void save_override(const boost::serialization::nvp<bool> & pair, BOOST_PFTO int) {
-        _dict[pair.name()] = xmlrpc_c::value_boolean(pair.value());
-    }
+    void save_override(const boost::serialization::nvp<bool> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // name-value pair handling for double values
-    void save_override(const boost::serialization::nvp<double> & pair, BOOST_PFTO int) {
-        _dict[pair.name()] = xmlrpc_c::value_double(pair.value());
-    }
+    void save_override(const boost::serialization::nvp<double> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // name-value pair handling for float values
-    void save_override(const boost::serialization::nvp<float> & pair, BOOST_PFTO int) {
-        _dict[pair.name()] = xmlrpc_c::value_double(pair.value());
-    }
+    void save_override(const boost::serialization::nvp<float> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // name-value pair handling for std::string values
-    void save_override(const boost::serialization::nvp<std::string> & pair, BOOST_PFTO int) {
-        _dict[pair.name()] = xmlrpc_c::value_string(pair.value());
-    }
-#else
-    // default processing - kick back to our superclass
-    template<class T>
-    void save_override(const T & t) {
-        boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>::save_override(t);
-    }
+    void save_override(const boost::serialization::nvp<std::string> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
-    // Add special key "class_version" in the dictionary to hold the version
-    // number of the class we're archiving.
-    void save_override(const boost::archive::version_type & t) {
-        _dict["class_version"] = xmlrpc_c::value_int(static_cast<const int>(t));
-    }
-
-    // Don't bother archiving tracking_type, class_id_optional_type Boost special values
-    void save_override(const boost::archive::tracking_type & t) {
-//        std::cerr << "Oarchive_xmlrpc_c dropping tracking_type" << std::endl;
-    }
-    void save_override(const boost::archive::class_id_optional_type & t) {
-//        std::cerr << "Oarchive_xmlrpc_c dropping class_id_optional_type" << std::endl;
-    }
-
-    // Template save_override implementation for boost::serialization:nvp<T>
-    // when T is an enumerated type
-    template <typename T>
-    void nvp_save_override(const boost::serialization::nvp<T> & pair,
-                            std::true_type is_enum,
-                            std::false_type is_class,
-                            std::false_type is_integral
-                           ) {
-        const char * key = pair.name();
-        _dict[key] = xmlrpc_c::value_int(int(pair.value()));
-    }
-
-    // Template save_override implementation for boost::serialization:nvp<T>
-    // when T is a class with a serialize() method
-    template <typename T>
-    void nvp_save_override(const boost::serialization::nvp<T> & pair,
-                            std::false_type is_enum,
-                            std::true_type is_class,
-                            std::false_type is_integral
-                           ) {
-        const char * key = pair.name();
-        XmlrpcSerializable<T> sValue(pair.value());
-        _dict[key] = sValue;
-    }
-
-    // Template save_override implementation for boost::serialization:nvp<T>
-    // when T is an integral type
-    template <typename T>
-    void nvp_save_override(const boost::serialization::nvp<T> & pair,
-                            std::false_type is_enum,
-                            std::false_type is_class,
-                            std::true_type is_integral
-                           ) {
-        const char * key = pair.name();
-        xmlrpc_c::value xmlrpcval;
-        // Split handling. 32-bit and smaller integers are saved as 32-bit
-        // values. Bigger integers are saved as 64-bit values.
-        if (sizeof(T) <= 4) {
-            // For signed integer values, save as xmlrpc_c::value_int (32 bit)
-            //
-            // For unsigned values, save as their bitwise-equivalent 32-bit
-            // signed int. They will be reinterpreted the other way when
-            // loaded again.
-            if (std::is_signed<T>::value) {
-                xmlrpcval = xmlrpc_c::value_int(pair.value());
-            } else {
-                uint32_t unsignedVal = pair.value();
-                int32_t signedBitwiseEquiv(*reinterpret_cast<int32_t*>(&unsignedVal));
-                xmlrpcval = xmlrpc_c::value_int(signedBitwiseEquiv);
-            }
-        } else {
-            // Similar to above, but we save as 8-byte (64-bit) type
-            // xmlrpc_c::value_i8
-            if (std::is_signed<T>::value) {
-                xmlrpcval = xmlrpc_c::value_i8(pair.value());
-            } else {
-                uint64_t unsignedVal = pair.value();
-                int64_t signedBitwiseEquiv(*reinterpret_cast<int64_t*>(&unsignedVal));
-                xmlrpcval = xmlrpc_c::value_i8(signedBitwiseEquiv);
-            }
-        }
-        _dict[key] = xmlrpcval;
-    }
-
-    // Template save_override for boost::serialization::nvp<T>
-    // (name/value pairs)
-    //
-    // This template uses one of the nvp_save_override specializations above,
-    // selected at compile time based on T's type traits
+    // name-value pair handling for LazyXmlrpcSerializable<T> values, which
+    // pass through their original xmlrpc_c::value if it is still valid
     template<typename T>
-    void save_override(const boost::serialization::nvp<T> & pair) {
-        // Select implementation at compile time depending on whether T is an
-        // enumerated type or a class
-        nvp_save_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
+    void save_override(const boost::serialization::nvp<LazyXmlrpcSerializable<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        xmlrpc_c::value xmlrpcVal = pair.value().toXmlrpcValue(_keyDict, _flags);
+        // When eliding defaults, skip the member entirely if nothing but its
+        // class_version was written or passed through, as for class members
+        if ((_flags & ElideDefaults_xmlrpc_c) && _onlyClassVersion(xmlrpcVal)) {
+            return;
+        }
+        _dict[_outputKey(pair.name())] = xmlrpcVal;
     }
 
-    // name-value pair handling for bool values
-    void save_override(const boost::serialization::nvp<bool> & pair) {
-        _dict[pair.name()] = xmlrpc_c::value_boolean(pair.value());
-    }
+    // name-value pair handling for byte string values
+    void save_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
-    // name-value pair handling for double values
-    void save_override(const boost::serialization::nvp<double> & pair) {
-        _dict[pair.name()] = xmlrpc_c::value_double(pair.value());
+    // name-value pair handling for SharedBuffer_xmlrpc_c<T> values, which
+    // pass through their xmlrpc_c::value without copying the content
+    template<typename T>
+    void save_override(const boost::serialization::nvp<SharedBuffer_xmlrpc_c<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _dict[_outputKey(pair.name())] = pair.value().toXmlrpcValue();
     }
 
-    // name-value pair handling for float values
-    void save_override(const boost::serialization::nvp<float> & pair) {
-        _dict[pair.name()] = xmlrpc_c::value_double(pair.value());
+    // name-value pair handling for ScaledFloat_xmlrpc_c values, which are
+    // saved as xmlrpc_c::value_int
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloat_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        if (_defaults.isDefault(pair.value())) {
+            return;
+        }
+        typedef typename ScaledFloat_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        _saveInteger(pair.name(), Encoding::encode(pair.value(), pair.name()));
     }
 
-    // name-value pair handling for std::string values
-    void save_override(const boost::serialization::nvp<std::string> & pair) {
-        _dict[pair.name()] = xmlrpc_c::value_string(pair.value());
+    // name-value pair handling for ScaledFloatArray_xmlrpc_c values, which
+    // are saved as an xmlrpc_c::value_array of xmlrpc_c::value_int
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloatArray_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        if (_defaults.isDefault(pair.value())) {
+            return;
+        }
+        typedef typename ScaledFloatArray_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        std::vector<int32_t> wire(pair.value().size());
+        Encoding::encode(pair.value().data(), wire.data(), wire.size(), pair.name());
+        _saveIntegerArray(pair.name(), wire);
     }
-#endif // ifdef BOOST_PFTO
 
     // Not sure why we need this, but things won't compile without it...
     template<class T>
@@ -334,7 +549,27 @@ public:
     }
 private:
     friend class boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>;
+
+    // Return the key to use in the output dictionary for the named member
+    std::string _outputKey(const std::string & name);
+
+    // Save an integer under the named member as a 32-bit xmlrpc_c::value_int
+    // or a 64-bit xmlrpc_c::value_i8
+    void _saveInteger(const char * name, int32_t value);
+    void _saveInteger(const char * name, int64_t value);
+
+    // Save integers under the named member as an xmlrpc_c::value_array of
+    // xmlrpc_c::value_int
+    void _saveIntegerArray(const char * name, const std::vector<int32_t> & values);
+
+    // Return true iff the given xmlrpc_c::value_struct holds nothing but a
+    // class_version
+    static bool _onlyClassVersion(const xmlrpc_c::value & structVal);
+
     std::map<std::string, xmlrpc_c::value> & _dict;
+    KeyDictionary_xmlrpc_c * _keyDict;
+    unsigned int _flags;
+    DefaultScope_xmlrpc_c _defaults;
 };
 
 /// @brief Boost input archive class to unpack from an xmlrpc_c::value_struct
@@ -342,40 +577,41 @@ private:
 class Iarchive_xmlrpc_c :
     public boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c> {
 public:
-    Iarchive_xmlrpc_c(const std::map<std::string, xmlrpc_c::value> & map) :
-    	_archiveMap(map) {}
-    Iarchive_xmlrpc_c(const xmlrpc_c::value_struct & archive) :
-        _archiveMap(static_cast<const std::map<std::string, xmlrpc_c::value>>(archive)) {}
+    /// @brief Unpack from the given dictionary.
+    /// @param map the dictionary to unpack from
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c used to expand
+    /// the dictionary's short keys to member names
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    Iarchive_xmlrpc_c(const std::map<std::string, xmlrpc_c::value> & map,
+                      const KeyDictionary_xmlrpc_c * keyDict = 0,
+                      unsigned int flags = 0);
+    /// @brief Unpack from the given dictionary, taking ownership of it rather
+    /// than copying it.
+    Iarchive_xmlrpc_c(std::map<std::string, xmlrpc_c::value> && map,
+                      const KeyDictionary_xmlrpc_c * keyDict = 0,
+                      unsigned int flags = 0);
+    Iarchive_xmlrpc_c(const xmlrpc_c::value_struct & archive,
+                      const KeyDictionary_xmlrpc_c * keyDict = 0,
+                      unsigned int flags = 0);
 
-#ifdef BOOST_PFTO
     // default processing - kick back to our superclass
     template<class T>
-    void load_override(T & t, BOOST_PFTO int) {
-        boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>::load_override(t, 0);
+    void load_override(T & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        // Note where the object and a default instance of its type live while
+        // loading, so that missing members can be set to their defaults.
+        DefaultScope_xmlrpc_c::Guard defaultGuard(_defaults, t,
+                                                  _flags & ElideDefaults_xmlrpc_c);
+        boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>::load_override(t ARCHIVE_XMLRPC_C_PFTO_ARG);
     }
 
     // Get class version number from special key "class_version" in the
     // xmlrpc_c::value_struct dictionary.
-    void load_override(boost::archive::version_type & t, BOOST_PFTO int) {
-        const std::string key("class_version");
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_int ival(_archiveMap.find(key)->second);
-        t = boost::archive::version_type(static_cast<int>(ival));
-    }
+    void load_override(boost::archive::version_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // Don't bother loading tracking_type and class_id_optional_type Boost
     // special values
-    void load_override(boost::archive::tracking_type & t, BOOST_PFTO int) {
-//        std::cerr << "Iarchive_xmlrpc_c not loading tracking_type" << std::endl;
-    }
-    void load_override(boost::archive::class_id_optional_type & t, BOOST_PFTO int) {
-//        std::cerr << "Iarchive_xmlrpc_c not loading class_id_optional_type" << std::endl;
-    }
+    void load_override(boost::archive::tracking_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+    void load_override(boost::archive::class_id_optional_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
 
     // Template load_override implementation for boost::serialization:nvp<T>
     // when T is an enumerated type
@@ -385,17 +621,17 @@ public:
                            std::false_type is_class,
                            std::false_type is_integral
                           ) {
-        const char * key = pair.name();
-        auto archiveIter = _archiveMap.find(key);
-        if (archiveIter == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                  key << "'";
-            throw(std::runtime_error(ss.str()));
+        // The archived value should be of type xmlrpc_c::value_int. If it
+        // isn't (and can't be coerced into the range of the enumerated
+        // type's underlying type), _loadInteger() will throw an exception
+        typedef typename std::underlying_type<T>::type U;
+        typedef typename std::conditional<(sizeof(U) <= 4), U, int32_t>::type Range;
+        int32_t intVal;
+        if (! _loadInteger(pair.name(), intVal, std::numeric_limits<Range>::min(),
+                           std::numeric_limits<Range>::max())) {
+            _loadMissing(pair.name(), pair.value());
+            return;
         }
-        // The returned value should be of type xmlrpc_c::value_int. If it
-        // isn't, the value_int cast below will throw an exception
-        int intVal(xmlrpc_c::value_int(archiveIter->second));
         // Cast the integer value to the enumerated type
         pair.value() = static_cast<T>(intVal);
     }
@@ -409,15 +645,27 @@ public:
                            std::false_type is_integral
                           ) {
         const char * key = pair.name();
-        auto archiveIter = _archiveMap.find(key);
+        auto archiveIter = _findMember(key);
         if (archiveIter == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                  key << "'";
-            throw(std::runtime_error(ss.str()));
+            if (_flags & MergeIntoExisting_xmlrpc_c) {
+                return;
+            }
+            // When eliding defaults, a missing class member was omitted
+            // because it matched a default-constructed instance of its type
+            if (_flags & ElideDefaults_xmlrpc_c) {
+                pair.value() = DefaultInstance_xmlrpc_c<T>();
+                return;
+            }
+            _throwMissingKey(key);
+        }
+        if (_flags & MergeIntoExisting_xmlrpc_c) {
+            // Load into the existing member rather than assigning a
+            // freshly decoded temporary, so that its buffers are kept
+            mergeInto_xmlrpc_c(pair.value(), archiveIter->second, _keyDict, _flags);
+            return;
         }
         xmlrpc_c::value xmlrpcVal = archiveIter->second;
-        pair.value() = XmlrpcSerializable<T>(xmlrpcVal);
+        pair.value() = XmlrpcSerializable<T>(xmlrpcVal, _keyDict, _flags);
     }
 
     // Template load_override implementation for boost::serialization:nvp<T>
@@ -428,46 +676,17 @@ public:
                            std::false_type is_class,
                            std::true_type is_integral
                           ) {
-        const std::string key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-
-        // Split handling. 32-bit and smaller integers are loaded from 32-bit
-        // values. Bigger integers are loaded from 64-bit values.
-        if (sizeof(T) <= 4) {
-            // For signed integer values, save as xmlrpc_c::value_int (32 bit)
-            //
-            // For unsigned values, save as their bitwise-equivalent 32-bit
-            // signed int. They will be reinterpreted the other way when
-            // loaded again.
-            xmlrpc_c::value_int xml_ival(_archiveMap.find(key)->second);
-            if (std::is_signed<T>::value) {
-                pair.value() = xml_ival.cvalue();
-            } else {
-                // We get the value as a signed int (from the matching save_override()
-                // above), and reinterpret to unsigned int.
-                int32_t signedBitwiseEquiv(xml_ival.cvalue());
-                uint32_t uval = *reinterpret_cast<uint32_t *>(&signedBitwiseEquiv);
-                pair.value() = uval;
-            }
-        } else {
-            // Similar to above, but we load from 8-byte (64-bit) type
-            // xmlrpc_c::value_i8
-            xmlrpc_c::value_i8 xml_ival(_archiveMap.find(key)->second);
-            if (std::is_signed<T>::value) {
-                pair.value() = xml_ival.cvalue();
-            } else {
-                // We get the value as a signed int (from the matching save_override()
-                // above), and reinterpret to unsigned int.
-                int64_t signedBitwiseEquiv(xml_ival.cvalue());
-                uint64_t uval = *reinterpret_cast<uint64_t *>(&signedBitwiseEquiv);
-                pair.value() = uval;
-            }
+        // Unsigned values are reinterpreted from their bitwise-equivalent
+        // signed value, and the size of the wire type selects 32-bit
+        // xmlrpc_c::value_int or 64-bit xmlrpc_c::value_i8 (see
+        // IntegralWire_xmlrpc_c).
+        typename IntegralWire_xmlrpc_c<T>::type wireVal;
+        if (! _loadInteger(pair.name(), wireVal, std::numeric_limits<T>::min(),
+                           std::numeric_limits<T>::max())) {
+            _loadMissing(pair.name(), pair.value());
+            return;
         }
+        pair.value() = IntegralWire_xmlrpc_c<T>::decode(wireVal);
     }
 
     // Template load_override for boost::serialization::nvp<T>
@@ -477,11 +696,11 @@ public:
     // selected at compile time based on T's type traits
     template<class T>
     void load_override(
-#ifndef BOOST_NO_FUNCTION_TEMPLATE_ORDERING
+#if !defined(BOOST_PFTO) || !defined(BOOST_NO_FUNCTION_TEMPLATE_ORDERING)
             const
 #endif
-            boost::serialization::nvp<T> & pair,
-            BOOST_PFTO int)
+            boost::serialization::nvp<T> & pair
+            ARCHIVE_XMLRPC_C_PFTO_PARAM)
     {
         // Select implementation at compile time depending on whether T is an
         // enumerated type or a class
@@ -489,245 +708,84 @@ public:
     }
 
     // Loader for name-value pair with bool value
-    void load_override(const boost::serialization::nvp<bool> & pair, BOOST_PFTO int) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_boolean bval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<bool>(bval);
-    }
+    void load_override(const boost::serialization::nvp<bool> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // Loader for name-value pair with double value
-    void load_override(const boost::serialization::nvp<double> & pair, BOOST_PFTO int) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_double dval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<double>(dval);
-    }
+    void load_override(const boost::serialization::nvp<double> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // Loader for name-value pair with float value
-    void load_override(const boost::serialization::nvp<float> & pair, BOOST_PFTO int) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_double dval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<float>(dval);
-    }
+    void load_override(const boost::serialization::nvp<float> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
     // Loader for name-value pair with std::string value
-    void load_override(const boost::serialization::nvp<std::string> & pair, BOOST_PFTO int) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_string sval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<std::string>(sval);
-    }
-
-#else
-    // default processing - kick back to our superclass
-    template<class T>
-    void load_override(T & t) {
-        boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>::load_override(t);
-    }
-
-    // Get class version number from special key "class_version" in the
-    // xmlrpc_c::value_struct dictionary.
-    void load_override(boost::archive::version_type & t) {
-        const std::string key("class_version");
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                  key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_int ival(_archiveMap.find(key)->second);
-        t = boost::archive::version_type(static_cast<int>(ival));
-    }
-
-    // Don't bother loading tracking_type and class_id_optional_type Boost
-    // special values
-    void load_override(boost::archive::tracking_type & t) {
-//        std::cerr << "Iarchive_xmlrpc_c not loading tracking_type" << std::endl;
-    }
-    void load_override(boost::archive::class_id_optional_type & t) {
-//        std::cerr << "Iarchive_xmlrpc_c not loading class_id_optional_type" << std::endl;
-    }
-
-    // Template load_override implementation for boost::serialization:nvp<T>
-    // when T is an enumerated type
-    template <typename T>
-    void nvp_load_override(const boost::serialization::nvp<T> & pair,
-                           std::true_type is_enum,
-                           std::false_type is_class,
-                           std::false_type is_integral
-                          ) {
-        const char * key = pair.name();
-        auto archiveIter = _archiveMap.find(key);
-        if (archiveIter == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                  key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        // The returned value should be of type xmlrpc_c::value_int. If it
-        // isn't, the value_int cast below will throw an exception
-        int intVal(xmlrpc_c::value_int(archiveIter->second));
-        // Cast the integer value to the enumerated type
-        pair.value() = static_cast<T>(intVal);
-    }
+    void load_override(const boost::serialization::nvp<std::string> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
-    // Template load_override implementation for boost::serialization:nvp<T>
-    // when T is a class with a serialize() method
-    template <typename T>
-    void nvp_load_override(const boost::serialization::nvp<T> & pair,
-                           std::false_type is_enum,
-                           std::true_type is_class,
-                           std::false_type is_integral
-                          ) {
+    // Loader for name-value pair with LazyXmlrpcSerializable<T> value. The
+    // xmlrpc_c::value is just stored, to be decoded on first access.
+    template<typename T>
+    void load_override(const boost::serialization::nvp<LazyXmlrpcSerializable<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
         const char * key = pair.name();
-        auto archiveIter = _archiveMap.find(key);
+        auto archiveIter = _findMember(key);
         if (archiveIter == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                  key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value xmlrpcVal = archiveIter->second;
-        pair.value() = XmlrpcSerializable<T>(xmlrpcVal);
-    }
-
-    // Template load_override implementation for boost::serialization:nvp<T>
-    // when T is an integral type
-    template <typename T>
-    void nvp_load_override(const boost::serialization::nvp<T> & pair,
-                           std::false_type is_enum,
-                           std::false_type is_class,
-                           std::true_type is_integral
-                          ) {
-        const std::string key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-
-        // Split handling. 32-bit and smaller integers are loaded from 32-bit
-        // values. Bigger integers are loaded from 64-bit values.
-        if (sizeof(T) <= 4) {
-            // For signed integer values, save as xmlrpc_c::value_int (32 bit)
-            //
-            // For unsigned values, save as their bitwise-equivalent 32-bit
-            // signed int. They will be reinterpreted the other way when
-            // loaded again.
-            xmlrpc_c::value_int xml_ival(_archiveMap.find(key)->second);
-            if (std::is_signed<T>::value) {
-                pair.value() = xml_ival.cvalue();
-            } else {
-                // We get the value as a signed int (from the matching save_override()
-                // above), and reinterpret to unsigned int.
-                int32_t signedBitwiseEquiv(xml_ival.cvalue());
-                uint32_t uval = *reinterpret_cast<uint32_t *>(&signedBitwiseEquiv);
-                pair.value() = uval;
+            if (_flags & MergeIntoExisting_xmlrpc_c) {
+                return;
             }
-        } else {
-            // Similar to above, but we load from 8-byte (64-bit) type
-            // xmlrpc_c::value_i8
-            xmlrpc_c::value_i8 xml_ival(_archiveMap.find(key)->second);
-            if (std::is_signed<T>::value) {
-                pair.value() = xml_ival.cvalue();
-            } else {
-                // We get the value as a signed int (from the matching save_override()
-                // above), and reinterpret to unsigned int.
-                int64_t signedBitwiseEquiv(xml_ival.cvalue());
-                uint64_t uval = *reinterpret_cast<uint64_t *>(&signedBitwiseEquiv);
-                pair.value() = uval;
+            if (_flags & ElideDefaults_xmlrpc_c) {
+                pair.value() = DefaultInstance_xmlrpc_c<T>();
+                return;
             }
+            _throwMissingKey(key);
         }
+        pair.value().setXmlrpcValue(archiveIter->second, _keyDict, _flags);
     }
 
-    // Template load_override for boost::serialization::nvp<T>
-    // (name/value pairs)
-    //
-    // This template uses one of the nvp_load_override specializations above,
-    // selected at compile time based on T's type traits
-    template<class T>
-    void load_override(const boost::serialization::nvp<T> & pair)
-    {
-        // Select implementation at compile time depending on whether T is an
-        // enumerated type or a class
-        nvp_load_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
-    }
+    // Loader for name-value pair with byte string value
+    void load_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM);
 
-    // Loader for name-value pair with bool value
-    void load_override(const boost::serialization::nvp<bool> & pair) {
+    // Loader for name-value pair with SharedBuffer_xmlrpc_c<T> value. Only a
+    // reference to the xmlrpc_c::value is kept; the content is not copied out
+    // until it is first accessed.
+    template<typename T>
+    void load_override(const boost::serialization::nvp<SharedBuffer_xmlrpc_c<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
         const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
+        auto archiveIter = _findMember(key);
+        if (archiveIter == _archiveMap.end()) {
+            _loadMissing(key, pair.value());
+            return;
         }
-        xmlrpc_c::value_boolean bval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<bool>(bval);
+        pair.value() = SharedBuffer_xmlrpc_c<T>(archiveIter->second);
     }
 
-    // Loader for name-value pair with double value
-    void load_override(const boost::serialization::nvp<double> & pair) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
+    // Loader for name-value pair with ScaledFloat_xmlrpc_c value
+    template<typename Float, typename Step, typename Offset>
+    void load_override(const boost::serialization::nvp<ScaledFloat_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        int32_t wire;
+        if (! _loadInteger(pair.name(), wire, std::numeric_limits<int32_t>::min(),
+                           std::numeric_limits<int32_t>::max())) {
+            _loadMissing(pair.name(), pair.value());
+            return;
         }
-        xmlrpc_c::value_double dval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<double>(dval);
+        pair.value() = ScaledFloat_xmlrpc_c<Float, Step, Offset>::Encoding::decode(wire);
     }
 
-    // Loader for name-value pair with float value
-    void load_override(const boost::serialization::nvp<float> & pair) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
+    // Loader for name-value pair with ScaledFloatArray_xmlrpc_c value. The
+    // member is resized rather than replaced, so it keeps its capacity.
+    template<typename Float, typename Step, typename Offset>
+    void load_override(const boost::serialization::nvp<ScaledFloatArray_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        std::vector<int32_t> wire;
+        if (! _loadIntegerArray(pair.name(), wire)) {
+            _loadMissing(pair.name(), pair.value());
+            return;
         }
-        xmlrpc_c::value_double dval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<float>(dval);
+        pair.value().resize(wire.size());
+        ScaledFloatArray_xmlrpc_c<Float, Step, Offset>::Encoding::decode(
+                wire.data(), pair.value().data(), wire.size());
     }
 
-    // Loader for name-value pair with std::string value
-    void load_override(const boost::serialization::nvp<std::string> & pair) {
-        const char * key = pair.name();
-        if (_archiveMap.find(key) == _archiveMap.end()) {
-            std::ostringstream ss;
-            ss << "xmlrpc_c::value_struct dictionary does not contain requested key '" <<
-                    key << "'";
-            throw(std::runtime_error(ss.str()));
-        }
-        xmlrpc_c::value_string sval(_archiveMap.find(key)->second);
-        pair.value() = static_cast<std::string>(sval);
-    }
-#endif // ifdef BOOST_PFTO
     // Not sure why we need this, but things won't compile without it...
     template<class T>
     void load(T & t) {
@@ -742,12 +800,216 @@ public:
 private:
     // For boost::serialization, we must make our superclass our friend!
     friend class boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>;
+
+    // Return an iterator to the archive map entry for the named member, or
+    // _archiveMap.end() if there is none. If we have a key dictionary, the
+    // name is first translated to its short key; names without a short key
+    // (e.g., added by a Migration_xmlrpc_c) are looked up as they are.
+    std::map<std::string, xmlrpc_c::value>::const_iterator
+    _findMember(const std::string & name) const;
+
+    // Load the named member from a 32-bit xmlrpc_c::value_int or a 64-bit
+    // xmlrpc_c::value_i8, returning false if the member is not in the
+    // dictionary. Other numeric types are coerced as allowed by our flags,
+    // throwing if the value is outside the member's range [memberMin,
+    // memberMax].
+    bool _loadInteger(const char * name, int32_t & value,
+                      int64_t memberMin, uint64_t memberMax) const;
+    bool _loadInteger(const char * name, int64_t & value,
+                      int64_t memberMin, uint64_t memberMax) const;
+
+    // Load the named member from an xmlrpc_c::value_array of 32-bit
+    // integers, coerced as for _loadInteger(), returning false if the member
+    // is not in the dictionary.
+    bool _loadIntegerArray(const char * name, std::vector<int32_t> & values) const;
+
+    // Load the named member from an xmlrpc_c::value_double, or an integer
+    // value if allowed by our flags, returning false if the member is not
+    // in the dictionary.
+    bool _loadDouble(const char * name, double & value) const;
+
+    // Throw the exception for a member missing from the dictionary
+    [[noreturn]] static void _throwMissingKey(const std::string & name);
+
+    // If we are eliding defaults and the given member belongs to the object
+    // being loaded, set it to its default value and return true. Otherwise
+    // return false.
+    template<typename M>
+    bool _loadDefault(M & member) const {
+        const M * dflt = _defaults.defaultMember(member);
+        if (! dflt) {
+            return(false);
+        }
+        member = *dflt;
+        return(true);
+    }
+
+    // Handle the named member missing from the dictionary: leave it alone if
+    // merging, otherwise set it to its default value if possible or throw.
+    template<typename M>
+    void _loadMissing(const char * name, M & member) const {
+        if (_flags & MergeIntoExisting_xmlrpc_c) {
+            return;
+        }
+        if (! _loadDefault(member)) {
+            _throwMissingKey(name);
+        }
+    }
+
     const std::map<std::string, xmlrpc_c::value> _archiveMap;
+    const KeyDictionary_xmlrpc_c * _keyDict;
+    unsigned int _flags;
+    DefaultScope_xmlrpc_c _defaults;
 };
 
 BOOST_SERIALIZATION_REGISTER_ARCHIVE(Oarchive_xmlrpc_c)
 BOOST_SERIALIZATION_REGISTER_ARCHIVE(Iarchive_xmlrpc_c)
 
+// The archive base classes are instantiated once in libarchive_xmlrpc_c rather
+// than in every translation unit which uses the archives.
+extern template class boost::archive::detail::common_oarchive<Oarchive_xmlrpc_c>;
+extern template class boost::archive::detail::common_iarchive<Iarchive_xmlrpc_c>;
+
+/// @brief Steps which upgrade the archived dictionary of a class from one
+/// class_version to the next.
+///
+/// Steps are applied in the order they were added. Member names are given as
+/// in serialize(), and are translated to short keys when the dictionary was
+/// written with a KeyDictionary_xmlrpc_c. Steps which refer to a member
+/// missing from the dictionary do nothing, so a migration never fails on a
+/// dictionary which is already partly in the newer form.
+///
+/// Migrations are registered per class via Migrations_xmlrpc_c<T>.
+class Migration_xmlrpc_c {
+public:
+    /// @brief Function which converts an archived member value
+    typedef std::function<xmlrpc_c::value(const xmlrpc_c::value &)> Transform;
+
+    /// @brief Move the member archived as oldName to newName
+    Migration_xmlrpc_c & rename(const std::string & oldName,
+                                const std::string & newName);
+
+    /// @brief Add the named member with the given value if it is not present,
+    /// e.g., for a member which did not exist in the older version
+    Migration_xmlrpc_c & setDefault(const std::string & name,
+                                    const xmlrpc_c::value & value);
+
+    /// @brief Remove the named member
+    Migration_xmlrpc_c & drop(const std::string & name);
+
+    /// @brief Replace the value of the named member with the result of
+    /// calling the given function on it
+    Migration_xmlrpc_c & transform(const std::string & name, Transform fn);
+
+    /// @brief Apply the steps to the given dictionary
+    /// @param dict the archived dictionary to rewrite
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c with which the
+    /// dictionary's short keys were written
+    void apply(std::map<std::string, xmlrpc_c::value> & dict,
+               const KeyDictionary_xmlrpc_c * keyDict) const;
+
+    /// @brief Upgrade the given dictionary to currentVersion, applying in
+    /// turn the migration for each version from its class_version up, and
+    /// setting its class_version to currentVersion. Dictionaries with no
+    /// (integer) class_version, or which are already at currentVersion or
+    /// later, are left untouched.
+    /// @param dict the archived dictionary to rewrite
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c with which the
+    /// dictionary's short keys were written
+    /// @param migrations map from class_version to the migration which
+    /// upgrades that version to the next
+    /// @param currentVersion the class_version the class is currently saved as
+    static void upgrade(std::map<std::string, xmlrpc_c::value> & dict,
+                        const KeyDictionary_xmlrpc_c * keyDict,
+                        const std::map<unsigned int, Migration_xmlrpc_c> & migrations,
+                        unsigned int currentVersion);
+
+private:
+    struct Step {
+        enum Kind { Rename, SetDefault, Drop, TransformValue };
+        Kind kind;
+        std::string name;
+        std::string newName;
+        xmlrpc_c::value value;
+        Transform fn;
+    };
+
+    std::vector<Step> _steps;
+};
+
+/// @brief Registry of the migrations for class T, keyed by the class_version
+/// they upgrade from.
+///
+/// When T is loaded through XmlrpcSerializable<T> (including as a member of
+/// another class), a dictionary with an older class_version is first
+/// rewritten by the registered migrations into the current form, so
+/// serialize() sees only current-version content and the current version
+/// number. For example, with BOOST_CLASS_VERSION(Foo, 2):
+///
+///   Migrations_xmlrpc_c<Foo>::from(0)
+///       .rename("_temp", "_temperature")
+///       .setDefault("_units", xmlrpc_c::value_string("K"));
+///   Migrations_xmlrpc_c<Foo>::from(1)
+///       .drop("_legacyFlag");
+///
+/// Classes with no registered migrations, and dictionaries already at the
+/// current version, are loaded exactly as before.
+///
+/// Migrations must be registered before any thread loads a T, e.g., at
+/// program startup before the loading threads are started, so that loads
+/// in any number of threads can read the registry without locking. As a
+/// best-effort check, from() throws once it can see that a T has been
+/// loaded; a registration which races with another thread's first load may
+/// not be caught. The Migration_xmlrpc_c it returns must not be modified
+/// after the first load either.
+template<typename T>
+class Migrations_xmlrpc_c {
+public:
+    /// @brief Return the migration which upgrades T's dictionary from the
+    /// given class_version to the next, creating it if necessary.
+    static Migration_xmlrpc_c & from(unsigned int version) {
+        if (_loaded().load(std::memory_order_acquire)) {
+            std::ostringstream ss;
+            ss << "Migrations_xmlrpc_c::from(" << version << ") called for " <<
+                  "(mangled) type " << typeid(T).name() << " after an " <<
+                  "object of the type was loaded";
+            throw(std::runtime_error(ss.str()));
+        }
+        return(_registry()[version]);
+    }
+
+    /// @brief Upgrade the given dictionary of T to the current version of T
+    /// @param dict the archived dictionary to rewrite
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c with which the
+    /// dictionary's short keys were written
+    static void apply(std::map<std::string, xmlrpc_c::value> & dict,
+                      const KeyDictionary_xmlrpc_c * keyDict) {
+        // Note the first load, after which the registry may not change. The
+        // flag is only written once, so it isn't contended.
+        std::atomic<bool> & loaded = _loaded();
+        if (! loaded.load(std::memory_order_acquire)) {
+            loaded.store(true, std::memory_order_release);
+        }
+        const std::map<unsigned int, Migration_xmlrpc_c> & registry = _registry();
+        if (registry.empty()) {
+            return;
+        }
+        Migration_xmlrpc_c::upgrade(dict, keyDict, registry,
+                                    boost::serialization::version<T>::value);
+    }
+
+private:
+    static std::map<unsigned int, Migration_xmlrpc_c> & _registry() {
+        static std::map<unsigned int, Migration_xmlrpc_c> registry;
+        return(registry);
+    }
+
+    static std::atomic<bool> & _loaded() {
+        static std::atomic<bool> loaded(false);
+        return(loaded);
+    }
+};
+
 /// Mix-in class which allows objects of its class to be serialized to/from
 /// Oarchive_xmlrpc_c/Iarchive_xmlrpc_c archives as composite members
 /// of other classes.
@@ -769,37 +1031,549 @@ public:
     /// xmlrpc_c::value_struct)
     /// @param xmlrpcVal the xmlrpc_c::value holding the content from which
     /// to construct
-    XmlrpcSerializable(const xmlrpc_c::value & xmlrpcVal) : T() {
-        // Cast the xmlrpc_c::value to xmlrpc_c::value_struct, then from that
-        // to std::map<std::string, xmlrpc_c::value>.
-        xmlrpc_c::value_struct statusStruct(xmlrpcVal);
-        std::map<std::string, xmlrpc_c::value> statusMap(statusStruct);
-
-        // Create an input archiver wrapper around the map and use serialize()
-        // to populate our members from its content.
-        Iarchive_xmlrpc_c iar(statusMap);
-        iar >> *this;
-    }
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c used to expand
+    /// short keys in the struct to member names
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    XmlrpcSerializable(const xmlrpc_c::value & xmlrpcVal,
+                       const KeyDictionary_xmlrpc_c * keyDict = 0,
+                       unsigned int flags = 0);
 
     virtual ~XmlrpcSerializable() {};
 
     /// @brief Cast to xmlrpc_c::value
-    operator xmlrpc_c::value() const { return(_toXmlRpcValueStruct()); }
+    operator xmlrpc_c::value() const { return(toValueStruct()); }
+
+    /// @brief Return an xmlrpc_c::value_struct containing a struct
+    /// (dictionary) with the object's serialized representation
+    /// @param keyDict if non-null, member names are replaced by short keys
+    /// from (and added to) this KeyDictionary_xmlrpc_c
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    xmlrpc_c::value_struct
+    toValueStruct(KeyDictionary_xmlrpc_c * keyDict = 0,
+                  unsigned int flags = 0) const;
+
+};
+
+// The decoding constructor and toValueStruct() are defined outside the class,
+// so that they are not implicitly inline and an explicit instantiation
+// declaration (see Archive_xmlrpc_c_instantiate.h) keeps them, and the
+// serializers they pull in, out of the translation units which use them.
+template<typename T>
+XmlrpcSerializable<T>::XmlrpcSerializable(const xmlrpc_c::value & xmlrpcVal,
+                                          const KeyDictionary_xmlrpc_c * keyDict,
+                                          unsigned int flags) : T() {
+    // Cast the xmlrpc_c::value to xmlrpc_c::value_struct, then from that
+    // to std::map<std::string, xmlrpc_c::value>.
+    xmlrpc_c::value_struct statusStruct(xmlrpcVal);
+    std::map<std::string, xmlrpc_c::value> statusMap(statusStruct);
+
+    // Bring dictionaries from older versions of T up to date
+    Migrations_xmlrpc_c<T>::apply(statusMap, keyDict);
+
+    // Hand the map over to an input archiver and use serialize() to
+    // populate our members from its content.
+    Iarchive_xmlrpc_c iar(std::move(statusMap), keyDict, flags);
+    iar >> *this;
+}
+
+template<typename T>
+xmlrpc_c::value_struct
+XmlrpcSerializable<T>::toValueStruct(KeyDictionary_xmlrpc_c * keyDict,
+                                     unsigned int flags) const {
+    std::map<std::string, xmlrpc_c::value> statusMap;
+    // Stuff our content into the statusMap, i.e., _serialize() to an
+    // output archiver wrapped around the statusMap.
+    Oarchive_xmlrpc_c oar(statusMap, keyDict, flags);
+    oar << *this;
+    // Finally, return a value_struct constructed from the map
+    return(xmlrpc_c::value_struct(statusMap));
+}
+
+/// @brief Update an existing object in place from an xmlrpc_c::value (which
+/// must be xmlrpc_c::value_struct), e.g., a long-lived configuration or state
+/// object receiving repeated updates.
+///
+/// This loads with MergeIntoExisting_xmlrpc_c: members present in the struct
+/// are loaded into obj member by member, members missing from it are left
+/// unchanged, and strings and byte strings keep their capacity. Migrations
+/// registered for T are applied as for XmlrpcSerializable<T>.
+/// @param obj the object to update
+/// @param xmlrpcVal the xmlrpc_c::value holding the update
+/// @param keyDict if non-null, the KeyDictionary_xmlrpc_c used to expand
+/// short keys in the struct to member names
+/// @param flags bitwise or of ArchiveFlags_xmlrpc_c values, to which
+/// MergeIntoExisting_xmlrpc_c is added
+template<typename T>
+void mergeInto_xmlrpc_c(T & obj, const xmlrpc_c::value & xmlrpcVal,
+                        const KeyDictionary_xmlrpc_c * keyDict,
+                        unsigned int flags) {
+    xmlrpc_c::value_struct updateStruct(xmlrpcVal);
+    std::map<std::string, xmlrpc_c::value> updateMap(updateStruct);
+    Migrations_xmlrpc_c<T>::apply(updateMap, keyDict);
+    Iarchive_xmlrpc_c iar(std::move(updateMap), keyDict,
+                          flags | MergeIntoExisting_xmlrpc_c);
+    iar >> obj;
+}
+
+// XmlrpcSerializable<T> is saved and loaded with the class version of T, so
+// that BOOST_CLASS_VERSION(T, n) applies to the archived class_version.
+namespace boost {
+namespace serialization {
+template<typename T>
+struct version<XmlrpcSerializable<T> > : version<T> {};
+} // namespace serialization
+} // namespace boost
+
+/// Wrapper for a serializable class member which defers decoding of the
+/// member until it is first accessed.
+///
+/// When an object containing a LazyXmlrpcSerializable<T> member is loaded from
+/// an Iarchive_xmlrpc_c, the member just keeps the xmlrpc_c::value it was
+/// given. The value is decoded into a T on the first call to get() (or any
+/// other accessor), so subsystems which are never looked at are never decoded.
+///
+/// When saved to an Oarchive_xmlrpc_c, a member which has not been modified
+/// since it was loaded passes its original xmlrpc_c::value through unchanged,
+/// with no decode and encode. This holds as long as neither archive uses a
+/// KeyDictionary_xmlrpc_c, both use the same flags and the member was not
+/// loaded with MergeIntoExisting_xmlrpc_c; otherwise the member is decoded
+/// and re-encoded. With ElideDefaults_xmlrpc_c, the member is omitted if
+/// nothing but its class_version would be saved, as for other class members.
+///
+/// When loaded with MergeIntoExisting_xmlrpc_c, the value only updates the
+/// content, so the previous content is decoded before the new value is
+/// stored.
+///
+/// The const accessors may be called concurrently from multiple threads; the
+/// decode happens exactly once. As with standard containers, the non-const
+/// accessors and assignment must not be used concurrently with any other
+/// access. If a KeyDictionary_xmlrpc_c was used when loading, it must remain
+/// valid until the member has been decoded.
+///
+/// T must be a default-constructible class with a serialize() method as
+/// required by XmlrpcSerializable<T>.
+template<typename T>
+class LazyXmlrpcSerializable {
+public:
+    /// @brief Default constructor, holding a default-constructed T
+    LazyXmlrpcSerializable() :
+        _obj(),
+        _decoded(true),
+        _xmlrpcVal(),
+        _keyDict(0),
+        _flags(0) {}
+
+    /// @brief Construct holding a copy of the given T
+    /// @param t the instance of type T to copy
+    LazyXmlrpcSerializable(const T & t) :
+        _obj(t),
+        _decoded(true),
+        _xmlrpcVal(),
+        _keyDict(0),
+        _flags(0) {}
+
+    /// @brief Construct from an xmlrpc_c::value (which must be
+    /// xmlrpc_c::value_struct), which will be decoded on first access
+    /// @param xmlrpcVal the xmlrpc_c::value holding the content
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c used to expand
+    /// short keys in the struct to member names
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    LazyXmlrpcSerializable(const xmlrpc_c::value & xmlrpcVal,
+                           const KeyDictionary_xmlrpc_c * keyDict = 0,
+                           unsigned int flags = 0) :
+        _obj(),
+        _decoded(false),
+        _xmlrpcVal(std::make_shared<const xmlrpc_c::value>(xmlrpcVal)),
+        _keyDict(keyDict),
+        _flags(flags) {}
+
+    /// @brief Copy constructor
+    LazyXmlrpcSerializable(const LazyXmlrpcSerializable & src) :
+        _obj(),
+        _decoded(false),
+        _xmlrpcVal(),
+        _keyDict(0),
+        _flags(0) {
+        *this = src;
+    }
+
+    /// @brief Assignment operator
+    LazyXmlrpcSerializable & operator=(const LazyXmlrpcSerializable & src) {
+        if (this != &src) {
+            // Lock the source so that we don't copy it in mid-decode
+            std::lock_guard<std::mutex> lock(src._decodeMutex);
+            _obj = src._obj;
+            _decoded.store(src._decoded.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+            _xmlrpcVal = src._xmlrpcVal;
+            _keyDict = src._keyDict;
+            _flags = src._flags;
+        }
+        return(*this);
+    }
+
+    /// @brief Assign from an instance of T
+    LazyXmlrpcSerializable & operator=(const T & t) {
+        _obj = t;
+        _decoded.store(true, std::memory_order_release);
+        _dropXmlrpcValue();
+        return(*this);
+    }
+
+    /// @brief Replace the content with the given xmlrpc_c::value (which must
+    /// be xmlrpc_c::value_struct), which will be decoded on first access
+    /// @param xmlrpcVal the xmlrpc_c::value holding the content
+    /// @param keyDict if non-null, the KeyDictionary_xmlrpc_c used to expand
+    /// short keys in the struct to member names
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    void setXmlrpcValue(const xmlrpc_c::value & xmlrpcVal,
+                        const KeyDictionary_xmlrpc_c * keyDict = 0,
+                        unsigned int flags = 0) {
+        // A merged value only updates the content, so any earlier value must
+        // be decoded first for the updates to apply in order
+        if (flags & MergeIntoExisting_xmlrpc_c) {
+            get();
+        }
+        _xmlrpcVal = std::make_shared<const xmlrpc_c::value>(xmlrpcVal);
+        _keyDict = keyDict;
+        _flags = flags;
+        _decoded.store(false, std::memory_order_release);
+    }
+
+    /// @brief Return true iff the content has been decoded
+    bool isDecoded() const { return(_decoded.load(std::memory_order_acquire)); }
+
+    /// @brief Return a const reference to the content, decoding it first if
+    /// necessary. This does not prevent the original xmlrpc_c::value from
+    /// being passed through when saved.
+    const T & get() const {
+        if (! _decoded.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(_decodeMutex);
+            if (! _decoded.load(std::memory_order_relaxed)) {
+                if (_flags & MergeIntoExisting_xmlrpc_c) {
+                    mergeInto_xmlrpc_c(_obj, *_xmlrpcVal, _keyDict, _flags);
+                } else {
+                    _obj = XmlrpcSerializable<T>(*_xmlrpcVal, _keyDict, _flags);
+                }
+                _decoded.store(true, std::memory_order_release);
+            }
+        }
+        return(_obj);
+    }
+
+    /// @brief Return a modifiable reference to the content, decoding it first
+    /// if necessary. Since the content may then be changed, the original
+    /// xmlrpc_c::value is discarded and the content will be re-encoded when
+    /// saved.
+    T & getMutable() {
+        get();
+        _dropXmlrpcValue();
+        return(_obj);
+    }
+
+    const T & operator*() const { return(get()); }
+    const T * operator->() const { return(&get()); }
+
+    /// @brief Return the content as an xmlrpc_c::value, passing through the
+    /// original xmlrpc_c::value if it is still valid for the given key
+    /// dictionary and flags.
+    /// @param keyDict if non-null, member names are replaced by short keys
+    /// from (and added to) this KeyDictionary_xmlrpc_c
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    xmlrpc_c::value toXmlrpcValue(KeyDictionary_xmlrpc_c * keyDict = 0,
+                                  unsigned int flags = 0) const {
+        if (passesThrough(keyDict, flags)) {
+            return(*_xmlrpcVal);
+        }
+        return(XmlrpcSerializable<T>(get()).toValueStruct(keyDict, flags));
+    }
+
+    /// @brief Return true iff toXmlrpcValue() with the given key dictionary
+    /// and flags would pass through the original xmlrpc_c::value.
+    bool passesThrough(const KeyDictionary_xmlrpc_c * keyDict,
+                       unsigned int flags) const {
+        return(_xmlrpcVal && ! _keyDict && ! keyDict && _flags == flags &&
+               ! (_flags & MergeIntoExisting_xmlrpc_c));
+    }
+
+    /// @brief Return the original xmlrpc_c::value, which is only meaningful
+    /// while passesThrough() is true for some key dictionary and flags.
+    const xmlrpc_c::value & xmlrpcValue() const { return(*_xmlrpcVal); }
 
 private:
-    /// @brief Return an xmlrpc_c::value containing a struct (dictionary) with
-    /// the object's serialized representation
-    xmlrpc_c::value_struct _toXmlRpcValueStruct() const {
-        std::map<std::string, xmlrpc_c::value> statusMap;
-        // Stuff our content into the statusMap, i.e., _serialize() to an
-        // output archiver wrapped around the statusMap.
-        Oarchive_xmlrpc_c oar(statusMap);
-        oar << *this;
-        // Finally, return a value_struct constructed from the map
-        return(xmlrpc_c::value_struct(statusMap));
+    void _dropXmlrpcValue() {
+        _xmlrpcVal.reset();
+        _keyDict = 0;
     }
 
+    /// The decoded content, valid once _decoded is true
+    mutable T _obj;
+    mutable std::atomic<bool> _decoded;
+    mutable std::mutex _decodeMutex;
+    /// The (undecoded) content, or null if there is none. xmlrpc-c does not
+    /// allow assignment to an xmlrpc_c::value which already holds a value,
+    /// so the value is held by pointer to be replaced or dropped.
+    std::shared_ptr<const xmlrpc_c::value> _xmlrpcVal;
+    const KeyDictionary_xmlrpc_c * _keyDict;
+    unsigned int _flags;
+};
+
+/// Read-only, reference-counted string or byte string member, for large
+/// content which is usually passed along or inspected rather than modified.
+///
+/// Copying a SharedBuffer_xmlrpc_c copies only a reference to the content.
+/// When loaded from an Iarchive_xmlrpc_c, it just holds a reference to the
+/// xmlrpc_c::value, and the content is copied out (once, for all copies)
+/// only when first accessed via get(), data() or size(). When saved to an
+/// Oarchive_xmlrpc_c, the xmlrpc_c::value is passed through if there is one,
+/// and is otherwise created once from the content and kept for later saves.
+///
+/// Content given as an rvalue T is moved, not copied, into the object.
+///
+/// All methods may be called concurrently from multiple threads.
+///
+/// T must be std::string (saved as xmlrpc_c::value_string) or
+/// std::vector<unsigned char> (saved as xmlrpc_c::value_bytestring); see the
+/// typedefs SharedString_xmlrpc_c and SharedBytes_xmlrpc_c below.
+template<typename T>
+class SharedBuffer_xmlrpc_c {
+public:
+    /// @brief Construct with empty content
+    SharedBuffer_xmlrpc_c() : _rep(std::make_shared<Rep>(T())) {}
+
+    /// @brief Construct holding the given content, which is moved into the
+    /// object if given as an rvalue.
+    /// @param content the content to hold
+    SharedBuffer_xmlrpc_c(T content) : _rep(std::make_shared<Rep>(std::move(content))) {}
+
+    /// @brief Construct holding a reference to the given xmlrpc_c::value
+    /// (which must be of the type matching T)
+    /// @param xmlrpcVal the xmlrpc_c::value holding the content
+    explicit SharedBuffer_xmlrpc_c(const xmlrpc_c::value & xmlrpcVal);
+
+    /// @brief Return the content, copying it out of the xmlrpc_c::value on
+    /// first access if necessary.
+    const T & get() const;
+
+    /// @brief Return a pointer to the first element of the content
+    const typename T::value_type * data() const { return(get().data()); }
+
+    /// @brief Return the size of the content
+    size_t size() const { return(get().size()); }
+
+    /// @brief Return the content as an xmlrpc_c::value, which is created only
+    /// on the first call if the object was not constructed from one.
+    xmlrpc_c::value toXmlrpcValue() const;
+
+private:
+    // Shared representation. Exactly one of content and xmlrpcVal is valid on
+    // construction, and the other is filled in on demand.
+    struct Rep {
+        Rep(T && c) : decoded(true), content(std::move(c)) {}
+        Rep(const xmlrpc_c::value & v) : decoded(false), xmlrpcVal(v) {}
+        const bool decoded;
+        mutable T content;
+        mutable xmlrpc_c::value xmlrpcVal;
+        mutable std::once_flag decodeOnce;
+        mutable std::once_flag encodeOnce;
+    };
+
+    static const xmlrpc_c::value & _check(const xmlrpc_c::value & v, std::string *) {
+        // Construct a value_string to verify the type
+        xmlrpc_c::value_string checked(v);
+        return(v);
+    }
+    static const xmlrpc_c::value & _check(const xmlrpc_c::value & v,
+                                          std::vector<unsigned char> *) {
+        // Construct a value_bytestring to verify the type
+        xmlrpc_c::value_bytestring checked(v);
+        return(v);
+    }
+
+    static void _decode(const xmlrpc_c::value & v, std::string & content) {
+        content = static_cast<std::string>(xmlrpc_c::value_string(v));
+    }
+    static void _decode(const xmlrpc_c::value & v,
+                        std::vector<unsigned char> & content) {
+        content = xmlrpc_c::value_bytestring(v).vectorUcharValue();
+    }
+
+    static xmlrpc_c::value _encode(const std::string & content) {
+        return(xmlrpc_c::value_string(content));
+    }
+    static xmlrpc_c::value _encode(const std::vector<unsigned char> & content) {
+        return(xmlrpc_c::value_bytestring(content));
+    }
+
+    std::shared_ptr<const Rep> _rep;
+};
+
+template<typename T>
+SharedBuffer_xmlrpc_c<T>::SharedBuffer_xmlrpc_c(const xmlrpc_c::value & xmlrpcVal) :
+    _rep(std::make_shared<Rep>(_check(xmlrpcVal, static_cast<T *>(0)))) {}
+
+template<typename T>
+const T &
+SharedBuffer_xmlrpc_c<T>::get() const {
+    const Rep & rep = *_rep;
+    std::call_once(rep.decodeOnce, [&rep]() {
+        if (! rep.decoded) {
+            _decode(rep.xmlrpcVal, rep.content);
+        }
+    });
+    return(rep.content);
+}
+
+template<typename T>
+xmlrpc_c::value
+SharedBuffer_xmlrpc_c<T>::toXmlrpcValue() const {
+    const Rep & rep = *_rep;
+    std::call_once(rep.encodeOnce, [&rep]() {
+        if (rep.decoded) {
+            rep.xmlrpcVal = _encode(rep.content);
+        }
+    });
+    return(rep.xmlrpcVal);
+}
+
+typedef SharedBuffer_xmlrpc_c<std::string> SharedString_xmlrpc_c;
+typedef SharedBuffer_xmlrpc_c<std::vector<unsigned char>> SharedBytes_xmlrpc_c;
+
+// The only two SharedBuffer_xmlrpc_c types are instantiated once in
+// libarchive_xmlrpc_c.
+extern template class SharedBuffer_xmlrpc_c<std::string>;
+extern template class SharedBuffer_xmlrpc_c<std::vector<unsigned char>>;
+
+/// Conversion between floating point values and the 32-bit integers which
+/// encode them as value = Offset + wire * Step, where Step and Offset are
+/// std::ratio types, e.g., Step std::ratio<1, 100> for a resolution of 0.01.
+/// Values are rounded to the nearest step, with ties away from zero.
+///
+/// The array conversions check the whole array, then convert it, in loops
+/// without branches which the compiler can vectorize.
+template<typename Float, typename Step, typename Offset = std::ratio<0> >
+struct ScaledEncoding_xmlrpc_c {
+    static_assert(std::is_floating_point<Float>::value,
+                  "ScaledEncoding_xmlrpc_c requires a floating point type");
+    static_assert(Step::num > 0, "ScaledEncoding_xmlrpc_c requires a positive Step");
+
+    /// @brief Return the encoding of the named member's value, throwing if
+    /// it is NaN or out of range
+    static int32_t encode(Float value, const char * name) {
+        int32_t wire;
+        encode(&value, &wire, 1, name);
+        return(wire);
+    }
+
+    /// @brief Encode n values of the named member into out, throwing if any
+    /// is NaN or out of range
+    static void encode(const Float * in, int32_t * out, size_t n,
+                       const char * name) {
+        const double scale = double(Step::den) / Step::num;
+        const double offset = double(Offset::num) / Offset::den;
+        // Limits of the scaled values which round into int32_t range. NaN
+        // fails both comparisons.
+        const double lo = double(INT32_MIN) - 0.5;
+        const double hi = double(INT32_MAX) + 0.5;
+        bool inRange = true;
+        for (size_t i = 0; i < n; i++) {
+            double scaled = (double(in[i]) - offset) * scale;
+            inRange &= (scaled > lo) & (scaled < hi);
+        }
+        if (! inRange) {
+            std::ostringstream ss;
+            ss << "Value of member '" << name <<
+                  "' is out of range for its scaled integer encoding";
+            throw(std::runtime_error(ss.str()));
+        }
+        for (size_t i = 0; i < n; i++) {
+            double scaled = (double(in[i]) - offset) * scale;
+            out[i] = static_cast<int32_t>(scaled + (scaled < 0 ? -0.5 : 0.5));
+        }
+    }
+
+    /// @brief Return the value encoded by wire
+    static Float decode(int32_t wire) {
+        Float value;
+        decode(&wire, &value, 1);
+        return(value);
+    }
+
+    /// @brief Decode n values from in into out
+    static void decode(const int32_t * in, Float * out, size_t n) {
+        const double step = double(Step::num) / Step::den;
+        const double offset = double(Offset::num) / Offset::den;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = static_cast<Float>(offset + in[i] * step);
+        }
+    }
+};
+
+/// Floating point member archived as a scaled 32-bit integer (see
+/// ScaledEncoding_xmlrpc_c) rather than as a double, e.g., for telemetry
+/// whose resolution is known. This costs a third or less of the text of a
+/// double in XML-RPC and JSON, and avoids double-to-text conversion.
+///
+/// The member converts to and from Float, and is otherwise used as one:
+///
+///   // temperature in degrees C to 0.01, offset so that -40 encodes as 0
+///   ScaledFloat_xmlrpc_c<float, std::ratio<1, 100>, std::ratio<-40> > _temp;
+///
+/// Archives throw if a value is NaN or out of range of the encoding.
+template<typename Float, typename Step, typename Offset = std::ratio<0> >
+class ScaledFloat_xmlrpc_c {
+public:
+    typedef ScaledEncoding_xmlrpc_c<Float, Step, Offset> Encoding;
+
+    /// @brief Construct holding the given value
+    ScaledFloat_xmlrpc_c(Float value = 0) : _value(value) {}
+
+    operator Float() const { return(_value); }
+
+private:
+    Float _value;
+};
+
+/// Array of floating point values archived as an array of scaled 32-bit
+/// integers (see ScaledEncoding_xmlrpc_c), converted in a single batch. The
+/// member is a std::vector<Float>, e.g.:
+///
+///   // powers in dBm to 0.1
+///   ScaledFloatArray_xmlrpc_c<float, std::ratio<1, 10> > _powers;
+template<typename Float, typename Step, typename Offset = std::ratio<0> >
+class ScaledFloatArray_xmlrpc_c : public std::vector<Float> {
+public:
+    typedef ScaledEncoding_xmlrpc_c<Float, Step, Offset> Encoding;
+
+    ScaledFloatArray_xmlrpc_c() {}
+
+    /// @brief Construct holding the given values, which are moved into the
+    /// object if given as an rvalue
+    ScaledFloatArray_xmlrpc_c(std::vector<Float> values) :
+        std::vector<Float>(std::move(values)) {}
+};
+
+/// @brief std::ratio for a resolution of Decimals decimal places
+template<unsigned int Decimals>
+struct DecimalStep_xmlrpc_c {
+    typedef std::ratio_multiply<std::ratio<1, 10>,
+            typename DecimalStep_xmlrpc_c<Decimals - 1>::type> type;
+};
+template<>
+struct DecimalStep_xmlrpc_c<0> {
+    typedef std::ratio<1> type;
 };
 
+/// @brief Floating point member archived with a fixed number of decimal
+/// places, e.g., FixedDecimals_xmlrpc_c<double, 3> for millimeters in meters
+template<typename Float, unsigned int Decimals>
+using FixedDecimals_xmlrpc_c =
+        ScaledFloat_xmlrpc_c<Float, typename DecimalStep_xmlrpc_c<Decimals>::type>;
+
+/// @brief Array of floating point values archived with a fixed number of
+/// decimal places
+template<typename Float, unsigned int Decimals>
+using FixedDecimalsArray_xmlrpc_c =
+        ScaledFloatArray_xmlrpc_c<Float, typename DecimalStep_xmlrpc_c<Decimals>::type>;
 
 #endif // ifndef _ARCHIVE_XMLRPC_C_H_
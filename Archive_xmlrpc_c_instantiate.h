@@ -0,0 +1,76 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+
+#ifndef _ARCHIVE_XMLRPC_C_INSTANTIATE_H_
+#define _ARCHIVE_XMLRPC_C_INSTANTIATE_H_
+
+/// @file Archive_xmlrpc_c_instantiate.h
+///
+/// Opt-in macros to compile the archive code for a serializable type T just
+/// once, rather than in every translation unit which saves or loads a T.
+///
+/// Put ARCHIVE_XMLRPC_C_EXTERN(T) in the header which defines T, after the
+/// class definition:
+///
+///   class Foo {
+///       ...
+///       template<class Archive>
+///       void serialize(Archive & ar, const unsigned int version) { ... }
+///   };
+///   ARCHIVE_XMLRPC_C_EXTERN(Foo)
+///
+/// and ARCHIVE_XMLRPC_C_INSTANTIATE(T) in exactly one .cpp file which is
+/// linked into the program (usually the one which implements T):
+///
+///   ARCHIVE_XMLRPC_C_INSTANTIATE(Foo)
+///
+/// Both must appear at global scope. T must be named by a type name without
+/// commas; use a typedef for template types.
+///
+/// This covers XmlrpcSerializable<T> and the Boost serializers for T and
+/// XmlrpcSerializable<T>, which is where serialize() is instantiated for the
+/// archives. Translation units which include the ARCHIVE_XMLRPC_C_EXTERN(T)
+/// declaration then instantiate none of that, whether T is saved or loaded
+/// directly or as a member of another class.
+
+#include "Archive_xmlrpc_c.h"
+#include <boost/archive/detail/iserializer.hpp>
+#include <boost/archive/detail/oserializer.hpp>
+
+#define ARCHIVE_XMLRPC_C_TYPE_INSTANTIATIONS(EXTERN, T) \
+    EXTERN template class XmlrpcSerializable<T>; \
+    EXTERN template class boost::archive::detail::oserializer<Oarchive_xmlrpc_c, T>; \
+    EXTERN template class boost::archive::detail::iserializer<Iarchive_xmlrpc_c, T>; \
+    EXTERN template class boost::archive::detail::oserializer<Oarchive_xmlrpc_c, XmlrpcSerializable<T> >; \
+    EXTERN template class boost::archive::detail::iserializer<Iarchive_xmlrpc_c, XmlrpcSerializable<T> >;
+
+/// @brief Declare that the archive code for T is instantiated elsewhere, by
+/// ARCHIVE_XMLRPC_C_INSTANTIATE(T)
+#define ARCHIVE_XMLRPC_C_EXTERN(T) ARCHIVE_XMLRPC_C_TYPE_INSTANTIATIONS(extern, T)
+
+/// @brief Instantiate the archive code for T
+#define ARCHIVE_XMLRPC_C_INSTANTIATE(T) ARCHIVE_XMLRPC_C_TYPE_INSTANTIATIONS(, T)
+
+#endif // ifndef _ARCHIVE_XMLRPC_C_INSTANTIATE_H_
@@ -0,0 +1,387 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+/*
+ * ReplayHarness_xmlrpc_c.cpp
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <xmlrpc-c/xml.hpp>
+#include <boost/io/ios_state.hpp>
+#include "ReplayHarness_xmlrpc_c.h"
+
+// Return the whole content of the named file
+static std::string
+readFile(const std::string & fileName) {
+    std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (! in) {
+        std::ostringstream ss;
+        ss << "Cannot open recorded message file '" << fileName << "'";
+        throw(std::runtime_error(ss.str()));
+    }
+    std::ostringstream content;
+    content << in.rdbuf();
+    return(content.str());
+}
+
+// Return true iff the two values are of the same type and hold the same
+// content. Doubles are compared bitwise.
+static bool
+sameValue(const xmlrpc_c::value & a, const xmlrpc_c::value & b) {
+    if (a.type() != b.type()) {
+        return(false);
+    }
+    switch (a.type()) {
+    case xmlrpc_c::value::TYPE_INT:
+        return(xmlrpc_c::value_int(a).cvalue() == xmlrpc_c::value_int(b).cvalue());
+    case xmlrpc_c::value::TYPE_I8:
+        return(xmlrpc_c::value_i8(a).cvalue() == xmlrpc_c::value_i8(b).cvalue());
+    case xmlrpc_c::value::TYPE_BOOLEAN:
+        return(xmlrpc_c::value_boolean(a).cvalue() == xmlrpc_c::value_boolean(b).cvalue());
+    case xmlrpc_c::value::TYPE_DOUBLE: {
+        double da = xmlrpc_c::value_double(a).cvalue();
+        double db = xmlrpc_c::value_double(b).cvalue();
+        return(std::memcmp(&da, &db, sizeof(da)) == 0);
+    }
+    case xmlrpc_c::value::TYPE_STRING:
+        return(xmlrpc_c::value_string(a).cvalue() == xmlrpc_c::value_string(b).cvalue());
+    case xmlrpc_c::value::TYPE_BYTESTRING:
+        return(xmlrpc_c::value_bytestring(a).vectorUcharValue() ==
+               xmlrpc_c::value_bytestring(b).vectorUcharValue());
+    case xmlrpc_c::value::TYPE_ARRAY: {
+        std::vector<xmlrpc_c::value> va = xmlrpc_c::value_array(a).vectorValueValue();
+        std::vector<xmlrpc_c::value> vb = xmlrpc_c::value_array(b).vectorValueValue();
+        if (va.size() != vb.size()) {
+            return(false);
+        }
+        for (size_t i = 0; i < va.size(); i++) {
+            if (! sameValue(va[i], vb[i])) {
+                return(false);
+            }
+        }
+        return(true);
+    }
+    case xmlrpc_c::value::TYPE_STRUCT: {
+        std::map<std::string, xmlrpc_c::value> ma = xmlrpc_c::value_struct(a);
+        std::map<std::string, xmlrpc_c::value> mb = xmlrpc_c::value_struct(b);
+        if (ma.size() != mb.size()) {
+            return(false);
+        }
+        for (auto ita = ma.begin(), itb = mb.begin(); ita != ma.end(); ++ita, ++itb) {
+            if (ita->first != itb->first || ! sameValue(ita->second, itb->second)) {
+                return(false);
+            }
+        }
+        return(true);
+    }
+    case xmlrpc_c::value::TYPE_NIL:
+        return(true);
+    default:
+        // The archives never write other types
+        return(false);
+    }
+}
+
+// Compare a saved struct with the recorded one it was loaded from. Every
+// saved member must match the recorded member; recorded members which were
+// not saved are counted in unserialized. Nested structs are compared the same
+// way. Returns true iff the saved struct matches.
+static bool
+sameStruct(const xmlrpc_c::value & recorded, const xmlrpc_c::value & saved,
+           size_t & unserialized) {
+    std::map<std::string, xmlrpc_c::value> recordedMap = xmlrpc_c::value_struct(recorded);
+    std::map<std::string, xmlrpc_c::value> savedMap = xmlrpc_c::value_struct(saved);
+    bool same = true;
+    for (auto it = savedMap.begin(); it != savedMap.end(); ++it) {
+        auto recordedIter = recordedMap.find(it->first);
+        if (recordedIter == recordedMap.end()) {
+            same = false;
+        } else if (it->second.type() == xmlrpc_c::value::TYPE_STRUCT &&
+                   recordedIter->second.type() == xmlrpc_c::value::TYPE_STRUCT) {
+            same &= sameStruct(recordedIter->second, it->second, unserialized);
+        } else {
+            same &= sameValue(recordedIter->second, it->second);
+        }
+    }
+    for (auto it = recordedMap.begin(); it != recordedMap.end(); ++it) {
+        if (! savedMap.count(it->first)) {
+            unserialized++;
+        }
+    }
+    return(same);
+}
+
+// Return the given percentile of the sorted values
+static double
+percentile(const std::vector<double> & sorted, double pct) {
+    if (sorted.empty()) {
+        return(0);
+    }
+    size_t index = static_cast<size_t>(pct / 100.0 * (sorted.size() - 1) + 0.5);
+    return(sorted[index]);
+}
+
+// Return the process's peak resident set size in KB
+static long
+processPeakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return(0);
+    }
+    return(usage.ru_maxrss);
+}
+
+ReplayHarness_xmlrpc_c::ReplayHarness_xmlrpc_c(unsigned int flags) :
+    _flags(flags),
+    _peakRssKb(0) {}
+
+void
+ReplayHarness_xmlrpc_c::loadDirectory(const std::string & dirName) {
+    DIR * dir = opendir(dirName.c_str());
+    if (! dir) {
+        std::ostringstream ss;
+        ss << "Cannot open recorded message directory '" << dirName << "': " <<
+              std::strerror(errno);
+        throw(std::runtime_error(ss.str()));
+    }
+    // Load in name order, so runs over the same directory are repeatable
+    std::vector<std::string> fileNames;
+    while (struct dirent * entry = readdir(dir)) {
+        std::string name(entry->d_name);
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".xml") == 0) {
+            fileNames.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(fileNames.begin(), fileNames.end());
+
+    for (size_t f = 0; f < fileNames.size(); f++) {
+        std::string fileName = dirName + "/" + fileNames[f];
+        std::string xml = readFile(fileName);
+        // Struct payloads, alone or in arrays, are the messages to replay
+        std::string messageType;
+        std::vector<xmlrpc_c::value> values;
+        try {
+            if (xml.find("<methodCall") != std::string::npos) {
+                xmlrpc_c::paramList params;
+                xmlrpc_c::xml::parseCall(xml, &messageType, &params);
+                for (size_t i = 0; i < params.size(); i++) {
+                    values.push_back(params[i]);
+                }
+            } else {
+                xmlrpc_c::rpcOutcome outcome;
+                xmlrpc_c::xml::parseResponse(xml, &outcome);
+                if (outcome.succeeded()) {
+                    values.push_back(outcome.getResult());
+                }
+                messageType = fileNames[f].substr(0, fileNames[f].find('.'));
+            }
+        } catch (std::exception & e) {
+            std::ostringstream ss;
+            ss << "Cannot parse recorded message file '" << fileName << "': " <<
+                  e.what();
+            throw(std::runtime_error(ss.str()));
+        }
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i].type() == xmlrpc_c::value::TYPE_STRUCT) {
+                addMessage(messageType, values[i], xml.size());
+            } else if (values[i].type() == xmlrpc_c::value::TYPE_ARRAY) {
+                std::vector<xmlrpc_c::value> elements =
+                        xmlrpc_c::value_array(values[i]).vectorValueValue();
+                for (size_t e = 0; e < elements.size(); e++) {
+                    if (elements[e].type() == xmlrpc_c::value::TYPE_STRUCT) {
+                        addMessage(messageType, elements[e], xml.size() / elements.size());
+                    }
+                }
+            }
+        }
+    }
+}
+
+void
+ReplayHarness_xmlrpc_c::addMessage(const std::string & messageType,
+                                   const xmlrpc_c::value & payload,
+                                   size_t bytes) {
+    Message message = { payload, bytes };
+    _messages[messageType].push_back(message);
+}
+
+bool
+ReplayHarness_xmlrpc_c::run(std::ostream & report, unsigned int iterations) {
+    typedef std::chrono::steady_clock Clock;
+    // Leave the caller's stream formatting as we found it
+    boost::io::ios_flags_saver flagsSaver(report);
+    boost::io::ios_precision_saver precisionSaver(report);
+    bool allSame = true;
+    _results.clear();
+    report << std::left << std::setw(24) << "type" << std::right <<
+              std::setw(8) << "msgs" << std::setw(12) << "replays/s" <<
+              std::setw(10) << "MB/s" << std::setw(10) << "p50 us" <<
+              std::setw(10) << "p90 us" << std::setw(10) << "p99 us" <<
+              std::setw(10) << "max us" << "  fidelity" << std::endl;
+
+    for (auto typeIter = _messages.begin(); typeIter != _messages.end(); ++typeIter) {
+        const std::string & messageType = typeIter->first;
+        const std::vector<Message> & messages = typeIter->second;
+        auto replayerIter = _replayers.find(messageType);
+        if (replayerIter == _replayers.end()) {
+            report << std::left << std::setw(24) << messageType << std::right <<
+                      std::setw(8) << messages.size() <<
+                      "  skipped: no registered type" << std::endl;
+            continue;
+        }
+        const Replayer & replay = replayerIter->second;
+        Result & result = _results[messageType];
+        result.messages = messages.size();
+
+        // Check fidelity once per message, and keep only the messages which
+        // replay without error for timing
+        std::vector<const Message *> timed;
+        for (size_t i = 0; i < messages.size(); i++) {
+            try {
+                xmlrpc_c::value saved = replay(messages[i].payload);
+                if (! sameStruct(messages[i].payload, saved,
+                                 result.unserializedMembers)) {
+                    result.fidelityFailures++;
+                }
+                timed.push_back(&messages[i]);
+            } catch (std::exception & e) {
+                result.fidelityFailures++;
+                report << messageType << " message " << i << ": " << e.what() <<
+                          std::endl;
+            }
+        }
+
+        std::vector<double> latencies;
+        latencies.reserve(timed.size() * iterations);
+        for (unsigned int iter = 0; iter < iterations; iter++) {
+            for (size_t i = 0; i < timed.size(); i++) {
+                Clock::time_point start = Clock::now();
+                replay(timed[i]->payload);
+                std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+                latencies.push_back(elapsed.count());
+                result.bytes += timed[i]->bytes;
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        result.replays = latencies.size();
+        for (size_t i = 0; i < latencies.size(); i++) {
+            result.seconds += latencies[i] * 1.0e-9;
+        }
+        result.p50Ns = percentile(latencies, 50);
+        result.p90Ns = percentile(latencies, 90);
+        result.p99Ns = percentile(latencies, 99);
+        result.maxNs = latencies.empty() ? 0 : latencies.back();
+        allSame &= (result.fidelityFailures == 0);
+
+        report << std::left << std::setw(24) << messageType << std::right <<
+                  std::fixed << std::setprecision(1) <<
+                  std::setw(8) << result.messages <<
+                  std::setw(12) << std::setprecision(0) << result.replaysPerSecond() <<
+                  std::setw(10) << std::setprecision(1) <<
+                  (result.seconds > 0 ? result.bytes / result.seconds / 1.0e6 : 0) <<
+                  std::setw(10) << std::setprecision(2) << result.p50Ns / 1000 <<
+                  std::setw(10) << result.p90Ns / 1000 <<
+                  std::setw(10) << result.p99Ns / 1000 <<
+                  std::setw(10) << result.maxNs / 1000 << "  " <<
+                  (result.fidelityFailures ? "FAILED " : "ok ") <<
+                  result.fidelityFailures << "/" << result.messages;
+        if (result.unserializedMembers) {
+            report << " (" << result.unserializedMembers <<
+                      " recorded members not serialized)";
+        }
+        report << std::endl;
+    }
+    _peakRssKb = processPeakRssKb();
+    report << "peak RSS " << _peakRssKb << " KB" << std::endl;
+    return(allSame);
+}
+
+void
+ReplayHarness_xmlrpc_c::writeBaseline(const std::string & fileName) const {
+    std::ofstream out(fileName.c_str());
+    if (! out) {
+        std::ostringstream ss;
+        ss << "Cannot write replay baseline file '" << fileName << "'";
+        throw(std::runtime_error(ss.str()));
+    }
+    out << "# type replays/s p50_ns p90_ns p99_ns" << std::endl;
+    for (auto it = _results.begin(); it != _results.end(); ++it) {
+        out << it->first << " " << it->second.replaysPerSecond() << " " <<
+               it->second.p50Ns << " " << it->second.p90Ns << " " <<
+               it->second.p99Ns << std::endl;
+    }
+}
+
+bool
+ReplayHarness_xmlrpc_c::compareBaseline(const std::string & fileName,
+                                        double tolerance,
+                                        std::ostream & report) const {
+    std::istringstream in(readFile(fileName));
+    boost::io::ios_flags_saver flagsSaver(report);
+    boost::io::ios_precision_saver precisionSaver(report);
+    bool ok = true;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string messageType;
+        double baseRate, baseP50, baseP90, baseP99;
+        if (! (fields >> messageType >> baseRate >> baseP50 >> baseP90 >> baseP99)) {
+            std::ostringstream ss;
+            ss << "Bad line in replay baseline file '" << fileName << "': " << line;
+            throw(std::runtime_error(ss.str()));
+        }
+        auto it = _results.find(messageType);
+        if (it == _results.end()) {
+            report << messageType << ": in baseline but not replayed" << std::endl;
+            continue;
+        }
+        // Throughput and median latency are stable enough to gate on; the
+        // tail percentiles are reported only.
+        double rateChange = baseRate > 0 ? it->second.replaysPerSecond() / baseRate - 1 : 0;
+        double p50Change = baseP50 > 0 ? it->second.p50Ns / baseP50 - 1 : 0;
+        double p99Change = baseP99 > 0 ? it->second.p99Ns / baseP99 - 1 : 0;
+        bool regressed = rateChange < -tolerance || p50Change > tolerance;
+        ok &= ! regressed;
+        report << std::left << std::setw(24) << messageType << std::right <<
+                  std::showpos << std::fixed << std::setprecision(1) <<
+                  " throughput " << rateChange * 100 << "%" <<
+                  ", p50 " << p50Change * 100 << "%" <<
+                  ", p99 " << p99Change * 100 << "%" << std::noshowpos <<
+                  (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return(ok);
+}
@@ -0,0 +1,163 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+
+#ifndef _REPLAYHARNESS_XMLRPC_C_H_
+#define _REPLAYHARNESS_XMLRPC_C_H_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <xmlrpc-c/base.hpp>
+#include "Archive_xmlrpc_c.h"
+
+/// @brief Replays recorded XML-RPC traffic through Iarchive_xmlrpc_c and
+/// Oarchive_xmlrpc_c, measuring performance and checking round-trip fidelity
+/// per message type.
+///
+/// Each message type is registered with the C++ class its struct payloads
+/// decode to. Each replay of a message loads the payload into an
+/// XmlrpcSerializable<T> and saves it back to an xmlrpc_c::value_struct, and
+/// the saved struct is compared with the original. Members which the class
+/// does not serialize are reported but are not fidelity failures; members
+/// whose value changes are.
+///
+/// Results can be written as a baseline, and later runs compared with it to
+/// catch performance regressions.
+///
+/// Usage, in a service's own replay program:
+///
+///   ReplayHarness_xmlrpc_c harness;
+///   harness.registerType<StatusClass>("getStatus");
+///   harness.loadDirectory("recorded");
+///   bool ok = harness.run(std::cout, 1000);
+///   ok &= harness.compareBaseline("replay.baseline", 0.10, std::cout);
+class ReplayHarness_xmlrpc_c {
+public:
+    /// @brief Per message type results of run()
+    struct Result {
+        Result() : messages(0), replays(0), bytes(0), seconds(0),
+            p50Ns(0), p90Ns(0), p99Ns(0), maxNs(0),
+            unserializedMembers(0), fidelityFailures(0) {}
+        /// Number of distinct recorded messages
+        size_t messages;
+        /// Number of load/save replays timed
+        size_t replays;
+        /// Recorded XML bytes replayed
+        size_t bytes;
+        /// Total time spent replaying
+        double seconds;
+        /// Replay latency percentiles and maximum, in nanoseconds
+        double p50Ns;
+        double p90Ns;
+        double p99Ns;
+        double maxNs;
+        /// Number of recorded members the class does not serialize
+        size_t unserializedMembers;
+        /// Number of messages which did not survive the round trip
+        size_t fidelityFailures;
+
+        /// @brief Replays per second
+        double replaysPerSecond() const { return(seconds > 0 ? replays / seconds : 0); }
+    };
+
+    /// @brief Construct
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values to load and
+    /// save with
+    ReplayHarness_xmlrpc_c(unsigned int flags = 0);
+
+    /// @brief Register the class which payloads of the given message type
+    /// decode to. For recorded calls, the message type is the method name;
+    /// for recorded responses, it is the file name up to its first '.'.
+    template<typename T>
+    void registerType(const std::string & messageType) {
+        unsigned int flags = _flags;
+        _replayers[messageType] = [flags](const xmlrpc_c::value & payload) {
+            XmlrpcSerializable<T> obj(payload, 0, flags);
+            return(xmlrpc_c::value(obj.toValueStruct(0, flags)));
+        };
+    }
+
+    /// @brief Load all of the recorded XML-RPC call and response files
+    /// (*.xml) in the given directory. Struct parameters of calls, and struct
+    /// results of responses, become messages of their type.
+    /// @throws std::runtime_error if the directory or a file cannot be read
+    /// or parsed
+    void loadDirectory(const std::string & dirName);
+
+    /// @brief Add a payload of the given message type to replay
+    /// @param messageType the message type
+    /// @param payload the payload, which must be an xmlrpc_c::value_struct
+    /// @param bytes the size of the recorded message
+    void addMessage(const std::string & messageType,
+                    const xmlrpc_c::value & payload, size_t bytes);
+
+    /// @brief Replay each message of each registered type the given number
+    /// of times, and write a report of the results.
+    /// @param report stream for the report
+    /// @param iterations number of replays of each message
+    /// @return true iff every message survived the round trip
+    bool run(std::ostream & report, unsigned int iterations);
+
+    /// @brief Return the results of the last run(), by message type
+    const std::map<std::string, Result> & results() const { return(_results); }
+
+    /// @brief Return the process's peak resident set size at the end of the
+    /// last run(), in KB. This is a high-water mark for the whole process,
+    /// so it is not broken down by message type.
+    long peakRssKb() const { return(_peakRssKb); }
+
+    /// @brief Write the results of the last run() as a baseline file
+    /// @throws std::runtime_error if the file cannot be written
+    void writeBaseline(const std::string & fileName) const;
+
+    /// @brief Compare the results of the last run() with a baseline file
+    /// @param fileName the baseline file
+    /// @param tolerance allowed fractional loss of throughput or growth of
+    /// median latency, e.g., 0.10 for 10%
+    /// @param report stream for the comparison report
+    /// @return true iff no message type regressed beyond the tolerance
+    /// @throws std::runtime_error if the file cannot be read
+    bool compareBaseline(const std::string & fileName, double tolerance,
+                         std::ostream & report) const;
+
+private:
+    typedef std::function<xmlrpc_c::value(const xmlrpc_c::value &)> Replayer;
+
+    struct Message {
+        xmlrpc_c::value payload;
+        size_t bytes;
+    };
+
+    unsigned int _flags;
+    std::map<std::string, Replayer> _replayers;
+    std::map<std::string, std::vector<Message>> _messages;
+    std::map<std::string, Result> _results;
+    long _peakRssKb;
+};
+
+#endif // ifndef _REPLAYHARNESS_XMLRPC_C_H_
@@ -0,0 +1,384 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+/*
+ * Sizer_xmlrpc_c.cpp
+ */
+#define BOOST_ARCHIVE_SOURCE
+
+#include <cmath>
+#include <cstdio>
+#include "Sizer_xmlrpc_c.h"
+
+template class boost::archive::detail::common_oarchive<Sizer_xmlrpc_c>;
+
+// Length of a string literal
+#define LITERAL_LEN(s) (sizeof(s) - 1)
+
+// Fixed XML-RPC text around a struct and each of its members, and around
+// each type of value. The i8 tag allows for the "ex:" namespace prefix
+// xmlrpc-c uses in its Apache dialect.
+static const size_t XmlrpcStructBytes =
+        LITERAL_LEN("<value><struct>\r\n") + LITERAL_LEN("</struct></value>\r\n");
+static const size_t XmlrpcMemberBytes =
+        LITERAL_LEN("<member><name></name>\r\n") + LITERAL_LEN("</member>\r\n");
+static const size_t XmlrpcIntBytes = LITERAL_LEN("<value><i4></i4></value>");
+static const size_t XmlrpcI8Bytes = LITERAL_LEN("<value><ex:i8></ex:i8></value>");
+static const size_t XmlrpcBooleanBytes = LITERAL_LEN("<value><boolean>0</boolean></value>");
+static const size_t XmlrpcDoubleBytes = LITERAL_LEN("<value><double></double></value>");
+static const size_t XmlrpcStringBytes = LITERAL_LEN("<value><string></string></value>");
+static const size_t XmlrpcArrayBytes =
+        LITERAL_LEN("<value><array><data>\r\n") + LITERAL_LEN("</data></array></value>");
+static const size_t XmlrpcBase64Bytes =
+        LITERAL_LEN("<value><base64>\r\n") + LITERAL_LEN("</base64></value>");
+// xmlrpc-c may add fractional seconds, to the microsecond
+static const size_t XmlrpcDatetimeBytes =
+        LITERAL_LEN("<value><dateTime.iso8601>19980717T14:08:55.000000</dateTime.iso8601></value>");
+static const size_t XmlrpcNilBytes = LITERAL_LEN("<value><ex:nil/></value>");
+
+// Number of characters in the decimal representation of value
+static size_t
+decimalDigits(long long value) {
+    unsigned long long magnitude = value < 0 ?
+            0 - static_cast<unsigned long long>(value) : value;
+    size_t len = value < 0 ? 2 : 1;
+    while (magnitude >= 10) {
+        magnitude /= 10;
+        len++;
+    }
+    return(len);
+}
+
+// Upper bound on the characters xmlrpc-c uses for a double. It writes
+// doubles without an exponent, with at most 17 significant digits.
+static size_t
+xmlrpcDoubleDigits(double value) {
+    if (! std::isfinite(value)) {
+        return(0);  // not representable in XML-RPC; the save will fail
+    }
+    size_t len = std::signbit(value) ? 1 : 0;
+    double magnitude = std::fabs(value);
+    if (magnitude >= 1) {
+        // integer digits, point, fraction digits
+        len += static_cast<size_t>(std::floor(std::log10(magnitude))) + 1 + 1 + 17;
+    } else {
+        // "0.", leading fraction zeros, significant digits
+        size_t leadingZeros = magnitude == 0 ? 0 :
+                static_cast<size_t>(-std::floor(std::log10(magnitude))) - 1;
+        len += 2 + leadingZeros + 17;
+    }
+    return(len);
+}
+
+// Upper bound on the XML text for a string, allowing for escaping of the
+// XML markup characters and carriage returns
+static size_t
+xmlrpcStringBytes(const char * str, size_t len) {
+    size_t bytes = len;
+    for (size_t i = 0; i < len; i++) {
+        switch (str[i]) {
+        case '&':  bytes += LITERAL_LEN("&amp;") - 1; break;
+        case '<':  bytes += LITERAL_LEN("&lt;") - 1; break;
+        case '>':  bytes += LITERAL_LEN("&gt;") - 1; break;
+        case '\r': bytes += LITERAL_LEN("&#x0d;") - 1; break;
+        default: break;
+        }
+    }
+    return(bytes);
+}
+
+// Exact length of a quoted JSON string, escaped as by Oarchive_json
+static size_t
+jsonStringBytes(const char * str, size_t len) {
+    size_t bytes = len + 2;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r' || c == '\t') {
+            bytes += 1;
+        } else if (c < 0x20) {
+            bytes += 5;
+        }
+    }
+    return(bytes);
+}
+
+// Length of the base64 encoding of the given number of bytes
+static size_t
+base64Bytes(size_t nBytes) {
+    return(((nBytes + 2) / 3) * 4);
+}
+
+// Length of the XML text for the base64 encoding of the given number of
+// bytes. xmlrpc-c breaks its base64 into lines of at most 76 characters.
+static size_t
+xmlrpcBase64Bytes(size_t nBytes) {
+    size_t encoded = base64Bytes(nBytes);
+    size_t lineBreaks = encoded / 76 + 1;
+    return(XmlrpcBase64Bytes + encoded + lineBreaks * LITERAL_LEN("\r\n"));
+}
+
+// Upper bound on the XML-RPC text for an arbitrary xmlrpc_c::value, adding
+// the number of entries in any dictionaries it holds to fieldCount
+static size_t
+xmlrpcValueBytes(const xmlrpc_c::value & value, size_t & fieldCount) {
+    switch (value.type()) {
+    case xmlrpc_c::value::TYPE_INT:
+        return(XmlrpcIntBytes + decimalDigits(xmlrpc_c::value_int(value).cvalue()));
+    case xmlrpc_c::value::TYPE_I8:
+        return(XmlrpcI8Bytes + decimalDigits(xmlrpc_c::value_i8(value).cvalue()));
+    case xmlrpc_c::value::TYPE_BOOLEAN:
+        return(XmlrpcBooleanBytes);
+    case xmlrpc_c::value::TYPE_DOUBLE:
+        return(XmlrpcDoubleBytes +
+               xmlrpcDoubleDigits(xmlrpc_c::value_double(value).cvalue()));
+    case xmlrpc_c::value::TYPE_DATETIME:
+        return(XmlrpcDatetimeBytes);
+    case xmlrpc_c::value::TYPE_STRING: {
+        const std::string str = xmlrpc_c::value_string(value).cvalue();
+        return(XmlrpcStringBytes + xmlrpcStringBytes(str.data(), str.size()));
+    }
+    case xmlrpc_c::value::TYPE_BYTESTRING:
+        return(xmlrpcBase64Bytes(xmlrpc_c::value_bytestring(value).length()));
+    case xmlrpc_c::value::TYPE_ARRAY: {
+        // Each element is on its own line
+        const std::vector<xmlrpc_c::value> elements =
+                xmlrpc_c::value_array(value).vectorValueValue();
+        size_t bytes = XmlrpcArrayBytes;
+        for (size_t i = 0; i < elements.size(); i++) {
+            bytes += xmlrpcValueBytes(elements[i], fieldCount) + LITERAL_LEN("\r\n");
+        }
+        return(bytes);
+    }
+    case xmlrpc_c::value::TYPE_STRUCT: {
+        const std::map<std::string, xmlrpc_c::value> dict =
+                xmlrpc_c::value_struct(value);
+        size_t bytes = XmlrpcStructBytes;
+        for (auto it = dict.begin(); it != dict.end(); it++) {
+            bytes += XmlrpcMemberBytes +
+                    xmlrpcStringBytes(it->first.data(), it->first.size()) +
+                    xmlrpcValueBytes(it->second, fieldCount);
+        }
+        fieldCount += dict.size();
+        return(bytes);
+    }
+    case xmlrpc_c::value::TYPE_NIL:
+        return(XmlrpcNilBytes);
+    default:
+        return(0);  // not representable in XML-RPC; the save will fail
+    }
+}
+
+// Length of a double as written by Oarchive_json, which writes NaN as null
+// and infinities as +/-1e999
+static size_t
+jsonDoubleBytes(double value, const char * format) {
+    if (std::isnan(value)) {
+        return(LITERAL_LEN("null"));
+    } else if (std::isinf(value)) {
+        return(value > 0 ? LITERAL_LEN("1e999") : LITERAL_LEN("-1e999"));
+    }
+    return(std::snprintf(0, 0, format, value));
+}
+
+// Length of the JSON equivalent of an arbitrary xmlrpc_c::value, formatted
+// as by Oarchive_json
+static size_t
+jsonValueBytes(const xmlrpc_c::value & value) {
+    switch (value.type()) {
+    case xmlrpc_c::value::TYPE_INT:
+        return(decimalDigits(xmlrpc_c::value_int(value).cvalue()));
+    case xmlrpc_c::value::TYPE_I8:
+        return(decimalDigits(xmlrpc_c::value_i8(value).cvalue()));
+    case xmlrpc_c::value::TYPE_BOOLEAN:
+        return(xmlrpc_c::value_boolean(value).cvalue() ?
+               LITERAL_LEN("true") : LITERAL_LEN("false"));
+    case xmlrpc_c::value::TYPE_DOUBLE:
+        return(jsonDoubleBytes(xmlrpc_c::value_double(value).cvalue(), "%.17g"));
+    case xmlrpc_c::value::TYPE_STRING: {
+        const std::string str = xmlrpc_c::value_string(value).cvalue();
+        return(jsonStringBytes(str.data(), str.size()));
+    }
+    case xmlrpc_c::value::TYPE_BYTESTRING:
+        return(base64Bytes(xmlrpc_c::value_bytestring(value).length()) +
+               LITERAL_LEN("\"\""));
+    case xmlrpc_c::value::TYPE_ARRAY: {
+        const std::vector<xmlrpc_c::value> elements =
+                xmlrpc_c::value_array(value).vectorValueValue();
+        size_t bytes = LITERAL_LEN("[]");
+        for (size_t i = 0; i < elements.size(); i++) {
+            bytes += (i ? LITERAL_LEN(",") : 0) + jsonValueBytes(elements[i]);
+        }
+        return(bytes);
+    }
+    case xmlrpc_c::value::TYPE_STRUCT: {
+        const std::map<std::string, xmlrpc_c::value> dict =
+                xmlrpc_c::value_struct(value);
+        size_t bytes = LITERAL_LEN("{}");
+        for (auto it = dict.begin(); it != dict.end(); it++) {
+            bytes += (it != dict.begin() ? LITERAL_LEN(",") : 0) +
+                    jsonStringBytes(it->first.data(), it->first.size()) +
+                    LITERAL_LEN(":") + jsonValueBytes(it->second);
+        }
+        return(bytes);
+    }
+    case xmlrpc_c::value::TYPE_NIL:
+        return(LITERAL_LEN("null"));
+    default:
+        return(0);  // never written by Oarchive_json
+    }
+}
+
+Sizer_xmlrpc_c::Sizer_xmlrpc_c(unsigned int flags) :
+    _flags(flags),
+    _defaults(),
+    _jsonMembers(0),
+    _size() {
+    _size.xmlrpcBytes = XmlrpcStructBytes;
+    _size.jsonBytes = LITERAL_LEN("{}");
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::archive::version_type & t
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addInteger("class_version", static_cast<int>(t), false, false);
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::serialization::nvp<bool> & pair
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addMember(pair.name(), XmlrpcBooleanBytes,
+               pair.value() ? LITERAL_LEN("true") : LITERAL_LEN("false"),
+               _defaults.isDefault(pair.value()));
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::serialization::nvp<double> & pair
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addFloat(pair.name(), pair.value(), "%.17g", _defaults.isDefault(pair.value()));
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::serialization::nvp<float> & pair
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addFloat(pair.name(), pair.value(), "%.9g", _defaults.isDefault(pair.value()));
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::serialization::nvp<std::string> & pair
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addContent(pair.name(), pair.value(), _defaults.isDefault(pair.value()));
+}
+
+void
+Sizer_xmlrpc_c::save_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                              ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+    _addContent(pair.name(), pair.value(), _defaults.isDefault(pair.value()));
+}
+
+void
+Sizer_xmlrpc_c::_addMember(const char * name, size_t xmlrpcValueBytes,
+                           size_t jsonValueBytes, bool elided) {
+    size_t nameLen = std::strlen(name);
+    // Oarchive_json writes every member, as ,"name":value
+    _size.jsonBytes += (_jsonMembers++ ? LITERAL_LEN(",") : 0) +
+            jsonStringBytes(name, nameLen) + LITERAL_LEN(":") + jsonValueBytes;
+    if (! elided) {
+        _size.fieldCount++;
+        _size.xmlrpcBytes += XmlrpcMemberBytes +
+                xmlrpcStringBytes(name, nameLen) + xmlrpcValueBytes;
+    }
+}
+
+void
+Sizer_xmlrpc_c::_addInteger(const char * name, long long value, bool isI8,
+                            bool elided) {
+    size_t digits = decimalDigits(value);
+    _addMember(name, (isI8 ? XmlrpcI8Bytes : XmlrpcIntBytes) + digits, digits,
+               elided);
+}
+
+void
+Sizer_xmlrpc_c::_addIntegerArray(const char * name,
+                                 const std::vector<int32_t> & values,
+                                 bool elided) {
+    // Each element is on its own line in XML-RPC, and followed by a comma
+    // (except the last) in JSON
+    size_t xmlrpcBytes = XmlrpcArrayBytes;
+    size_t jsonBytes = LITERAL_LEN("[]");
+    for (size_t i = 0; i < values.size(); i++) {
+        size_t digits = decimalDigits(values[i]);
+        xmlrpcBytes += XmlrpcIntBytes + digits + LITERAL_LEN("\r\n");
+        jsonBytes += digits + (i ? LITERAL_LEN(",") : 0);
+    }
+    _addMember(name, xmlrpcBytes, jsonBytes, elided);
+}
+
+void
+Sizer_xmlrpc_c::_addFloat(const char * name, double value,
+                          const char * jsonFormat, bool elided) {
+    _addMember(name, XmlrpcDoubleBytes + xmlrpcDoubleDigits(value),
+               jsonDoubleBytes(value, jsonFormat), elided);
+}
+
+void
+Sizer_xmlrpc_c::_addNested(const char * name,
+                           const SerializedSize_xmlrpc_c & nested,
+                           bool elidable) {
+    bool elided = elidable && (_flags & ElideDefaults_xmlrpc_c) &&
+            nested.fieldCount == 1;
+    _addMember(name, nested.xmlrpcBytes, nested.jsonBytes, elided);
+    if (! elided) {
+        _size.fieldCount += nested.fieldCount;
+    }
+}
+
+void
+Sizer_xmlrpc_c::_addPassThrough(const char * name,
+                                const xmlrpc_c::value & structVal) {
+    size_t nestedFields = 0;
+    size_t xmlrpcBytes = xmlrpcValueBytes(structVal, nestedFields);
+    bool elided = (_flags & ElideDefaults_xmlrpc_c) &&
+            nestedFields == 1 &&
+            xmlrpc_c::value_struct(structVal).cvalue().count("class_version");
+    _addMember(name, xmlrpcBytes, jsonValueBytes(structVal), elided);
+    if (! elided) {
+        _size.fieldCount += nestedFields;
+    }
+}
+
+void
+Sizer_xmlrpc_c::_addContent(const char * name, const std::string & value,
+                            bool elided) {
+    _addMember(name,
+               XmlrpcStringBytes + xmlrpcStringBytes(value.data(), value.size()),
+               jsonStringBytes(value.data(), value.size()), elided);
+}
+
+void
+Sizer_xmlrpc_c::_addContent(const char * name,
+                            const std::vector<unsigned char> & value,
+                            bool elided) {
+    _addMember(name, xmlrpcBase64Bytes(value.size()),
+               base64Bytes(value.size()) + LITERAL_LEN("\"\""), elided);
+}
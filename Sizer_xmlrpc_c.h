@@ -0,0 +1,271 @@
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=* 
+// ** Copyright UCAR (c) 1990 - 2016                                         
+// ** University Corporation for Atmospheric Research (UCAR)                 
+// ** National Center for Atmospheric Research (NCAR)                        
+// ** Boulder, Colorado, USA                                                 
+// ** BSD licence applies - redistribution and use in source and binary      
+// ** forms, with or without modification, are permitted provided that       
+// ** the following conditions are met:                                      
+// ** 1) If the software is modified to produce derivative works,            
+// ** such modified software should be clearly marked, so as not             
+// ** to confuse it with the version available from UCAR.                    
+// ** 2) Redistributions of source code must retain the above copyright      
+// ** notice, this list of conditions and the following disclaimer.          
+// ** 3) Redistributions in binary form must reproduce the above copyright   
+// ** notice, this list of conditions and the following disclaimer in the    
+// ** documentation and/or other materials provided with the distribution.   
+// ** 4) Neither the name of UCAR nor the names of its contributors,         
+// ** if any, may be used to endorse or promote products derived from        
+// ** this software without specific prior written permission.               
+// ** DISCLAIMER: THIS SOFTWARE IS PROVIDED "AS IS" AND WITHOUT ANY EXPRESS  
+// ** OR IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED      
+// ** WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.    
+// *=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*=*
+
+
+#ifndef _SIZER_XMLRPC_C_H_
+#define _SIZER_XMLRPC_C_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/archive/detail/common_oarchive.hpp>
+#include <boost/archive/detail/register_archive.hpp>
+#include "Archive_xmlrpc_c.h"
+
+/// @brief Encoded size of an object, as computed by Sizer_xmlrpc_c
+struct SerializedSize_xmlrpc_c {
+    SerializedSize_xmlrpc_c() : fieldCount(0), xmlrpcBytes(0), jsonBytes(0) {}
+
+    /// Number of entries in the xmlrpc_c::value_struct dictionaries written
+    /// by Oarchive_xmlrpc_c, over the object and all of its nested members,
+    /// including "class_version" entries.
+    size_t fieldCount;
+    /// Upper bound on the length of the XML-RPC text for the object's
+    /// xmlrpc_c::value_struct, as written by the xmlrpc-c serializer.
+    size_t xmlrpcBytes;
+    /// Length of the JSON text written by Oarchive_json for the object. This
+    /// is exact, except for LazyXmlrpcSerializable<T> members sized from
+    /// their original xmlrpc_c::value (see Sizer_xmlrpc_c).
+    size_t jsonBytes;
+};
+
+/// @brief Boost output archive class which computes the encoded size of an
+/// object rather than encoding it.
+///
+/// The sizer walks the same serialize() methods as the real archives, but
+/// only adds up lengths: nothing is copied, no xmlrpc_c::value objects are
+/// built, and nested members are sized in place. Use it to reserve output
+/// buffers, or to decide on compression or chunking, before saving:
+///
+///   Sizer_xmlrpc_c sizer;
+///   sizer << status;
+///   std::string json;
+///   json.reserve(sizer.size().jsonBytes);
+///
+/// or just SerializedSize_xmlrpc_c size = serializedSize_xmlrpc_c(status).
+///
+/// The xmlrpc_c sizes honor ElideDefaults_xmlrpc_c if it is given in flags;
+/// the JSON size is always for every member, as Oarchive_json writes them.
+/// Sizes are for plain member names; with a KeyDictionary_xmlrpc_c the
+/// dictionaries are usually smaller.
+///
+/// A LazyXmlrpcSerializable<T> member which Oarchive_xmlrpc_c would pass
+/// through is sized from its original xmlrpc_c::value alone, without
+/// decoding it. Its JSON size is then that of the JSON equivalent of the
+/// value, which matches what Oarchive_json writes for the decoded member
+/// only if the value holds exactly T's members, none of them float (written
+/// with fewer digits) or elided defaults. Other lazy members are decoded to
+/// size them, and their JSON size is exact.
+class Sizer_xmlrpc_c :
+    public boost::archive::detail::common_oarchive<Sizer_xmlrpc_c> {
+public:
+    /// @brief Construct a sizer for a single top-level object
+    /// @param flags bitwise or of ArchiveFlags_xmlrpc_c values
+    Sizer_xmlrpc_c(unsigned int flags = 0);
+
+    /// @brief Return the size of the object(s) sized so far
+    const SerializedSize_xmlrpc_c & size() const { return(_size); }
+
+    // default processing - kick back to our superclass
+    template<class T>
+    void save_override(const T & t ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        // Note where the object and a default instance of its type live
+        // while sizing, so that its members can be compared to their defaults.
+        DefaultScope_xmlrpc_c::Guard defaultGuard(_defaults, t,
+                                                  _flags & ElideDefaults_xmlrpc_c);
+        boost::archive::detail::common_oarchive<Sizer_xmlrpc_c>::save_override(t ARCHIVE_XMLRPC_C_PFTO_ARG);
+    }
+
+    // The special key "class_version" holds the version number of the class
+    void save_override(const boost::archive::version_type & t ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // Neither archive writes tracking_type or class_id_optional_type
+    void save_override(const boost::archive::tracking_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+    void save_override(const boost::archive::class_id_optional_type & ARCHIVE_XMLRPC_C_PFTO_PARAM) {}
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is an enumerated type
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::true_type is_enum,
+                           std::false_type is_class,
+                           std::false_type is_integral
+                          ) {
+        _addInteger(pair.name(), int(pair.value()), false,
+                    _defaults.isDefault(pair.value()));
+    }
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is a class with a serialize() method. The member is sized in
+    // place by a nested sizer.
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::true_type is_class,
+                           std::false_type is_integral
+                          ) {
+        Sizer_xmlrpc_c nestedSizer(_flags);
+        nestedSizer << pair.value();
+        _addNested(pair.name(), nestedSizer.size(), true);
+    }
+
+    // Template save_override implementation for boost::serialization:nvp<T>
+    // when T is an integral type
+    template <typename T>
+    void nvp_save_override(const boost::serialization::nvp<T> & pair,
+                           std::false_type is_enum,
+                           std::false_type is_class,
+                           std::true_type is_integral
+                          ) {
+        _addInteger(pair.name(), IntegralWire_xmlrpc_c<T>::encode(pair.value()),
+                    sizeof(T) > 4, _defaults.isDefault(pair.value()));
+    }
+
+    // Template save_override for boost::serialization::nvp<T>
+    // (name/value pairs)
+    //
+    // This template uses one of the nvp_save_override specializations above,
+    // selected at compile time based on T's type traits
+    template<typename T>
+    void save_override(const boost::serialization::nvp<T> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        nvp_save_override(pair, std::is_enum<T>{}, std::is_class<T>{}, std::is_integral<T>{});
+    }
+
+    // name-value pair handling for bool values
+    void save_override(const boost::serialization::nvp<bool> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // name-value pair handling for double values
+    void save_override(const boost::serialization::nvp<double> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // name-value pair handling for float values
+    void save_override(const boost::serialization::nvp<float> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // name-value pair handling for std::string values
+    void save_override(const boost::serialization::nvp<std::string> & pair ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // name-value pair handling for byte string values
+    void save_override(const boost::serialization::nvp<std::vector<unsigned char>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM);
+
+    // name-value pair handling for LazyXmlrpcSerializable<T> values. Where
+    // Oarchive_xmlrpc_c would pass the original xmlrpc_c::value through, that
+    // value is sized instead, without decoding it, since it may hold members
+    // T doesn't know.
+    template<typename T>
+    void save_override(const boost::serialization::nvp<LazyXmlrpcSerializable<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        if (pair.value().passesThrough(0, _flags)) {
+            _addPassThrough(pair.name(), pair.value().xmlrpcValue());
+            return;
+        }
+        Sizer_xmlrpc_c nestedSizer(_flags);
+        nestedSizer << pair.value().get();
+        _addNested(pair.name(), nestedSizer.size(), true);
+    }
+
+    // name-value pair handling for SharedBuffer_xmlrpc_c<T> values
+    template<typename T>
+    void save_override(const boost::serialization::nvp<SharedBuffer_xmlrpc_c<T>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        _addContent(pair.name(), pair.value().get());
+    }
+
+    // name-value pair handling for ScaledFloat_xmlrpc_c values
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloat_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        typedef typename ScaledFloat_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        _addInteger(pair.name(), Encoding::encode(pair.value(), pair.name()), false,
+                    _defaults.isDefault(pair.value()));
+    }
+
+    // name-value pair handling for ScaledFloatArray_xmlrpc_c values
+    template<typename Float, typename Step, typename Offset>
+    void save_override(const boost::serialization::nvp<ScaledFloatArray_xmlrpc_c<Float, Step, Offset>> & pair
+                       ARCHIVE_XMLRPC_C_PFTO_PARAM) {
+        typedef typename ScaledFloatArray_xmlrpc_c<Float, Step, Offset>::Encoding Encoding;
+        std::vector<int32_t> wire(pair.value().size());
+        Encoding::encode(pair.value().data(), wire.data(), wire.size(), pair.name());
+        _addIntegerArray(pair.name(), wire, _defaults.isDefault(pair.value()));
+    }
+
+    // Not sure why we need this, but things won't compile without it...
+    template<class T>
+    void save(T & t) {
+        std::ostringstream ss;
+        ss << "Sizer_xmlrpc_c only deals with name-value pairs, \n" <<
+              "failed to size (mangled) type: " <<
+              typeid(T).name() << "\n" <<
+              "\n(Try 'c++filt -t <type>' to demangle the type name.)";
+        throw(std::runtime_error(ss.str()));
+    }
+
+private:
+    friend class boost::archive::detail::common_oarchive<Sizer_xmlrpc_c>;
+
+    // Add a member whose value takes the given number of bytes in each
+    // encoding. If elided, the member counts toward the JSON size only.
+    void _addMember(const char * name, size_t xmlrpcValueBytes,
+                    size_t jsonValueBytes, bool elided);
+
+    void _addInteger(const char * name, long long value, bool isI8, bool elided);
+    void _addIntegerArray(const char * name, const std::vector<int32_t> & values,
+                          bool elided);
+    void _addFloat(const char * name, double value, const char * jsonFormat,
+                   bool elided);
+    // Add a nested struct member. If elidable and we're eliding defaults, it
+    // is omitted from the dictionary when it holds only its class_version,
+    // as Oarchive_xmlrpc_c does.
+    void _addNested(const char * name, const SerializedSize_xmlrpc_c & nested,
+                    bool elidable);
+    // Add a struct member which Oarchive_xmlrpc_c passes through as the
+    // given xmlrpc_c::value_struct, elided as for _addNested()
+    void _addPassThrough(const char * name, const xmlrpc_c::value & structVal);
+    void _addContent(const char * name, const std::string & value,
+                     bool elided = false);
+    void _addContent(const char * name, const std::vector<unsigned char> & value,
+                     bool elided = false);
+
+    unsigned int _flags;
+    DefaultScope_xmlrpc_c _defaults;
+    size_t _jsonMembers;
+    SerializedSize_xmlrpc_c _size;
+};
+
+BOOST_SERIALIZATION_REGISTER_ARCHIVE(Sizer_xmlrpc_c)
+
+extern template class boost::archive::detail::common_oarchive<Sizer_xmlrpc_c>;
+
+/// @brief Return the encoded size of the given object
+/// @param t the object to size
+/// @param flags bitwise or of ArchiveFlags_xmlrpc_c values, as would be used
+/// to save the object
+template<typename T>
+SerializedSize_xmlrpc_c serializedSize_xmlrpc_c(const T & t, unsigned int flags = 0) {
+    Sizer_xmlrpc_c sizer(flags);
+    sizer << t;
+    return(sizer.size());
+}
+
+#endif // ifndef _SIZER_XMLRPC_C_H_
@@ -0,0 +1,198 @@
+// benchJsonArchive.cpp
+//  Created on: Oct 18, 2026
+
+/// Benchmark the direct JSON archives against the two-step path of archiving
+/// to an xmlrpc_c::value_struct and converting between that and JSON using
+/// xmlrpc-c's JSON support.
+///
+/// Usage: benchJsonArchive [<iterations>]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <xmlrpc-c/base.h>
+#include <xmlrpc-c/json.h>
+#include <xmlrpc-c/base.hpp>
+#include <boost/serialization/nvp.hpp>
+#include "Archive_xmlrpc_c.h"
+#include "Archive_json.h"
+
+/// Nested subsystem status
+class SubsystemStatus {
+public:
+    SubsystemStatus() :
+        _name("transmitter"),
+        _temperature(41.25),
+        _voltage(27.9),
+        _faultCount(3),
+        _ok(true),
+        _message("nominal, last fault cleared at 2026-10-18T04:12:00Z") {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_name);
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_voltage);
+        ar & BOOST_SERIALIZATION_NVP(_faultCount);
+        ar & BOOST_SERIALIZATION_NVP(_ok);
+        ar & BOOST_SERIALIZATION_NVP(_message);
+    }
+
+    std::string _name;
+    double _temperature;
+    double _voltage;
+    int _faultCount;
+    bool _ok;
+    std::string _message;
+};
+
+/// Top-level status of the sort a dashboard would poll
+class BenchStatus {
+public:
+    BenchStatus() :
+        _hostname("radar-host-01"),
+        _azimuth(123.456),
+        _elevation(0.5),
+        _pulseCount(123456789),
+        _mode(2),
+        _transmitting(true),
+        _rotating(false),
+        _lastError("") {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_hostname);
+        ar & BOOST_SERIALIZATION_NVP(_azimuth);
+        ar & BOOST_SERIALIZATION_NVP(_elevation);
+        ar & BOOST_SERIALIZATION_NVP(_pulseCount);
+        ar & BOOST_SERIALIZATION_NVP(_mode);
+        ar & BOOST_SERIALIZATION_NVP(_transmitting);
+        ar & BOOST_SERIALIZATION_NVP(_rotating);
+        ar & BOOST_SERIALIZATION_NVP(_lastError);
+        ar & BOOST_SERIALIZATION_NVP(_transmitter);
+        ar & BOOST_SERIALIZATION_NVP(_receiver);
+        ar & BOOST_SERIALIZATION_NVP(_antenna);
+    }
+
+    std::string _hostname;
+    double _azimuth;
+    double _elevation;
+    int _pulseCount;
+    int _mode;
+    bool _transmitting;
+    bool _rotating;
+    std::string _lastError;
+    SubsystemStatus _transmitter;
+    SubsystemStatus _receiver;
+    SubsystemStatus _antenna;
+};
+
+// Throw if the xmlrpc_env holds a fault
+static void
+checkEnv(const xmlrpc_env & env) {
+    if (env.fault_occurred) {
+        throw(std::runtime_error(env.fault_string));
+    }
+}
+
+// Two-step save: archive to an xmlrpc_c::value_struct, then serialize that
+// to JSON with xmlrpc-c
+static std::string
+twoStepSave(const BenchStatus & status) {
+    xmlrpc_c::value xmlrpcVal = XmlrpcSerializable<BenchStatus>(status);
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+    xmlrpc_mem_block * outP = XMLRPC_MEMBLOCK_NEW(char, &env, 0);
+    checkEnv(env);
+    xmlrpc_value * cValP = xmlrpcVal.cValue();
+    xmlrpc_serialize_json(&env, cValP, outP);
+    xmlrpc_DECREF(cValP);
+    checkEnv(env);
+    std::string json(XMLRPC_MEMBLOCK_CONTENTS(char, outP),
+                     XMLRPC_MEMBLOCK_SIZE(char, outP));
+    XMLRPC_MEMBLOCK_FREE(char, outP);
+    xmlrpc_env_clean(&env);
+    return(json);
+}
+
+// Two-step load: parse JSON to an xmlrpc_c::value with xmlrpc-c, then
+// unpack that from an xmlrpc_c::value_struct
+static BenchStatus
+twoStepLoad(const std::string & json) {
+    xmlrpc_env env;
+    xmlrpc_env_init(&env);
+    xmlrpc_value * cValP = xmlrpc_parse_json(&env, json.c_str());
+    checkEnv(env);
+    xmlrpc_c::value xmlrpcVal(cValP);
+    xmlrpc_DECREF(cValP);
+    xmlrpc_env_clean(&env);
+    return(XmlrpcSerializable<BenchStatus>(xmlrpcVal));
+}
+
+// Direct save using Oarchive_json
+static std::string
+directSave(const BenchStatus & status) {
+    std::ostringstream os;
+    {
+        Oarchive_json oar(os);
+        oar << status;
+    }
+    return(os.str());
+}
+
+// Direct load using Iarchive_json
+static BenchStatus
+directLoad(const std::string & json) {
+    BenchStatus status;
+    Iarchive_json iar(json.data(), json.data() + json.size());
+    iar >> status;
+    return(status);
+}
+
+// Run func the given number of times, and report and return the mean time
+// per call in nanoseconds
+template<typename Func>
+static double
+timeIt(const char * label, int iterations, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        func();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+    std::cout << label << ": " << elapsed.count() / iterations << " ns/op" <<
+                 std::endl;
+    return(elapsed.count() / iterations);
+}
+
+int
+main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 100000;
+
+    BenchStatus status;
+    std::string twoStepJson = twoStepSave(status);
+    std::string directJson = directSave(status);
+    std::cout << "two-step JSON size: " << twoStepJson.size() << " bytes" << std::endl;
+    std::cout << "direct JSON size: " << directJson.size() << " bytes" << std::endl;
+
+    // Sanity check that each path can read what the other wrote
+    if (directLoad(twoStepJson)._transmitter._faultCount != 3 ||
+        twoStepLoad(directJson)._antenna._faultCount != 3) {
+        std::cerr << "JSON round trip failed" << std::endl;
+        return(1);
+    }
+
+    double twoStepSaveNs = timeIt("two-step save", iterations, [&]() { twoStepSave(status); });
+    double directSaveNs = timeIt("direct save  ", iterations, [&]() { directSave(status); });
+    double twoStepLoadNs = timeIt("two-step load", iterations, [&]() { twoStepLoad(directJson); });
+    double directLoadNs = timeIt("direct load  ", iterations, [&]() { directLoad(directJson); });
+    std::cout << "direct save speedup: " << twoStepSaveNs / directSaveNs << "x" << std::endl;
+    std::cout << "direct load speedup: " << twoStepLoadNs / directLoadNs << "x" << std::endl;
+    return(0);
+}
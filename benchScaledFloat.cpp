@@ -0,0 +1,235 @@
+// benchScaledFloat.cpp
+//  Created on: Oct 18, 2026
+
+/// Benchmark scaled integer encoding of floating point telemetry members
+/// (ScaledFloat_xmlrpc_c and ScaledFloatArray_xmlrpc_c) against the default
+/// path, which archives each float as an xmlrpc_c::value_double.
+///
+/// Reports the XML-RPC response and JSON sizes of a telemetry record and of
+/// an array of samples with each encoding, the time to save and load them,
+/// and the time per sample of the batch array conversions.
+///
+/// Usage: benchScaledFloat [<iterations>]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <xmlrpc-c/base.hpp>
+#include <xmlrpc-c/xml.hpp>
+#include <boost/serialization/nvp.hpp>
+#include "Archive_xmlrpc_c.h"
+#include "Archive_json.h"
+
+// Number of samples in the telemetry record's array
+static const size_t NSamples = 256;
+
+/// Telemetry record with plain float members, archived as doubles
+class PlainTelemetry {
+public:
+    PlainTelemetry() :
+        _temperature(41.37f),
+        _voltage(27.91f),
+        _current(3.208f),
+        _azimuth(123.45f),
+        _elevation(0.52f),
+        _peakPower(86.3f) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_voltage);
+        ar & BOOST_SERIALIZATION_NVP(_current);
+        ar & BOOST_SERIALIZATION_NVP(_azimuth);
+        ar & BOOST_SERIALIZATION_NVP(_elevation);
+        ar & BOOST_SERIALIZATION_NVP(_peakPower);
+    }
+
+    float _temperature;
+    float _voltage;
+    float _current;
+    float _azimuth;
+    float _elevation;
+    float _peakPower;
+};
+
+/// The same record with its members archived as scaled integers, at the
+/// resolution the sensors actually provide
+class ScaledTelemetry {
+public:
+    ScaledTelemetry() {}
+
+    ScaledTelemetry(const PlainTelemetry & plain) :
+        _temperature(plain._temperature),
+        _voltage(plain._voltage),
+        _current(plain._current),
+        _azimuth(plain._azimuth),
+        _elevation(plain._elevation),
+        _peakPower(plain._peakPower) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_voltage);
+        ar & BOOST_SERIALIZATION_NVP(_current);
+        ar & BOOST_SERIALIZATION_NVP(_azimuth);
+        ar & BOOST_SERIALIZATION_NVP(_elevation);
+        ar & BOOST_SERIALIZATION_NVP(_peakPower);
+    }
+
+    // degrees C to 0.01, with -40 encoded as 0
+    ScaledFloat_xmlrpc_c<float, std::ratio<1, 100>, std::ratio<-40> > _temperature;
+    FixedDecimals_xmlrpc_c<float, 2> _voltage;
+    FixedDecimals_xmlrpc_c<float, 3> _current;
+    FixedDecimals_xmlrpc_c<float, 2> _azimuth;
+    FixedDecimals_xmlrpc_c<float, 2> _elevation;
+    FixedDecimals_xmlrpc_c<float, 1> _peakPower;
+};
+
+/// Array of samples archived as scaled integers
+class ScaledSamples {
+public:
+    ScaledSamples() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_samples);
+    }
+
+    FixedDecimalsArray_xmlrpc_c<float, 2> _samples;
+};
+
+// The same samples as an xmlrpc_c::value_array of xmlrpc_c::value_double,
+// built by hand as there is no default archiving of arrays
+static xmlrpc_c::value
+doubleSamples(const std::vector<float> & samples) {
+    std::vector<xmlrpc_c::value> elements;
+    elements.reserve(samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        elements.push_back(xmlrpc_c::value_double(samples[i]));
+    }
+    std::map<std::string, xmlrpc_c::value> dict;
+    dict["class_version"] = xmlrpc_c::value_int(0);
+    dict["_samples"] = xmlrpc_c::value_array(elements);
+    return(xmlrpc_c::value_struct(dict));
+}
+
+// Save an xmlrpc_c::value as an XML-RPC response
+static std::string
+xmlResponse(const xmlrpc_c::value & value) {
+    std::string xml;
+    xmlrpc_c::xml::generateResponse(xmlrpc_c::rpcOutcome(value), &xml);
+    return(xml);
+}
+
+// Save as an XML-RPC response
+template<typename T>
+static std::string
+xmlSave(const T & t) {
+    return(xmlResponse(XmlrpcSerializable<T>(t).toValueStruct()));
+}
+
+// Load from an XML-RPC response
+template<typename T>
+static T
+xmlLoad(const std::string & xml) {
+    xmlrpc_c::rpcOutcome outcome;
+    xmlrpc_c::xml::parseResponse(xml, &outcome);
+    return(XmlrpcSerializable<T>(outcome.getResult()));
+}
+
+// Save as JSON
+template<typename T>
+static std::string
+jsonSave(const T & t) {
+    std::ostringstream os;
+    {
+        Oarchive_json oar(os);
+        oar << t;
+    }
+    return(os.str());
+}
+
+// Run func the given number of times and report the mean time per call
+template<typename Func>
+static void
+timeIt(const char * label, int iterations, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        func();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+    std::cout << label << ": " << elapsed.count() / iterations << " ns/op" <<
+                 std::endl;
+}
+
+int
+main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 100000;
+
+    PlainTelemetry plain;
+    ScaledTelemetry scaled(plain);
+    ScaledSamples samples;
+    for (size_t i = 0; i < NSamples; i++) {
+        samples._samples.push_back(-20.0f + 0.37f * i);
+    }
+
+    std::string plainXml = xmlSave(plain);
+    std::string scaledXml = xmlSave(scaled);
+    std::string doubleSamplesXml = xmlResponse(doubleSamples(samples._samples));
+    std::string scaledSamplesXml = xmlSave(samples);
+    std::cout << "record, double XML-RPC size : " << plainXml.size() << " bytes" << std::endl;
+    std::cout << "record, scaled XML-RPC size : " << scaledXml.size() << " bytes" << std::endl;
+    std::cout << "record, double JSON size    : " << jsonSave(plain).size() << " bytes" << std::endl;
+    std::cout << "record, scaled JSON size    : " << jsonSave(scaled).size() << " bytes" << std::endl;
+    std::cout << "samples, double XML-RPC size: " << doubleSamplesXml.size() << " bytes" << std::endl;
+    std::cout << "samples, scaled XML-RPC size: " << scaledSamplesXml.size() << " bytes" << std::endl;
+
+    // Sanity check the scaled round trips
+    ScaledTelemetry reloaded = xmlLoad<ScaledTelemetry>(scaledXml);
+    ScaledSamples reloadedSamples = xmlLoad<ScaledSamples>(scaledSamplesXml);
+    if (std::abs(reloaded._current - plain._current) > 0.0005f ||
+        reloadedSamples._samples.size() != NSamples ||
+        std::abs(reloadedSamples._samples[10] - samples._samples[10]) > 0.005f) {
+        std::cerr << "scaled round trip failed" << std::endl;
+        return(1);
+    }
+
+    timeIt("record, double XML-RPC save ", iterations, [&]() { xmlSave(plain); });
+    timeIt("record, scaled XML-RPC save ", iterations, [&]() { xmlSave(scaled); });
+    timeIt("record, double XML-RPC load ", iterations, [&]() { xmlLoad<PlainTelemetry>(plainXml); });
+    timeIt("record, scaled XML-RPC load ", iterations, [&]() { xmlLoad<ScaledTelemetry>(scaledXml); });
+    timeIt("record, double JSON save    ", iterations, [&]() { jsonSave(plain); });
+    timeIt("record, scaled JSON save    ", iterations, [&]() { jsonSave(scaled); });
+    timeIt("samples, double XML-RPC save", iterations / 10, [&]() {
+        xmlResponse(doubleSamples(samples._samples));
+    });
+    timeIt("samples, scaled XML-RPC save", iterations / 10, [&]() { xmlSave(samples); });
+
+    // Batch conversion alone, per sample
+    typedef FixedDecimalsArray_xmlrpc_c<float, 2>::Encoding Encoding;
+    std::vector<int32_t> wire(NSamples);
+    std::vector<float> decoded(NSamples);
+    int batches = iterations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < batches; i++) {
+        Encoding::encode(samples._samples.data(), wire.data(), NSamples, "_samples");
+        Encoding::decode(wire.data(), decoded.data(), NSamples);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+    std::cout << "batch encode+decode          : " << elapsed.count() / (batches * NSamples) <<
+                 " ns/sample" << std::endl;
+    // Use the result, so that the loop is not optimized away
+    return(decoded[1] == samples._samples[1] ? 0 : 1);
+}
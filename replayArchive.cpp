@@ -0,0 +1,109 @@
+// replayArchive.cpp
+//  Created on: Oct 18, 2026
+
+/// Replay recorded XML-RPC traffic through Iarchive_xmlrpc_c and
+/// Oarchive_xmlrpc_c, reporting throughput, latency percentiles and
+/// round-trip fidelity per message type and the peak RSS of the run, and
+/// optionally checking for performance regressions against a stored
+/// baseline.
+///
+/// Usage: replayArchive [-i <iterations>] [-b <baseline>] [-w <baseline>]
+///                      [-t <tolerance>] <directory>
+///
+///   -i  replays of each message (default 100)
+///   -b  compare with this baseline file, failing on regressions
+///   -w  write the results to this baseline file
+///   -t  allowed fractional regression for -b (default 0.10)
+///
+/// <directory> holds the recorded call and response files (*.xml). Recorded
+/// responses must be named <message type>.<anything>.xml, e.g.,
+/// getStatus.0001.xml; the message type of a call is its method name.
+///
+/// Exit status is 0 on success, 1 if any message failed its round trip or
+/// any message type regressed, and 2 on usage or file errors.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <boost/serialization/nvp.hpp>
+#include "ReplayHarness_xmlrpc_c.h"
+
+/// Example message payload. Replace or extend this section with the classes
+/// of the traffic being replayed, and register each below.
+class ExampleStatus {
+public:
+    ExampleStatus() :
+        _name(),
+        _temperature(0.0),
+        _faultCount(0),
+        _ok(false) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_name);
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_faultCount);
+        ar & BOOST_SERIALIZATION_NVP(_ok);
+    }
+
+private:
+    std::string _name;
+    double _temperature;
+    int _faultCount;
+    bool _ok;
+};
+
+/// Register the class for each message type to replay
+static void
+registerTypes(ReplayHarness_xmlrpc_c & harness) {
+    harness.registerType<ExampleStatus>("getStatus");
+}
+
+static void
+usage(const char * progName) {
+    std::cerr << "Usage: " << progName << " [-i <iterations>] [-b <baseline>] " <<
+                 "[-w <baseline>] [-t <tolerance>] <directory>" << std::endl;
+    exit(2);
+}
+
+int
+main(int argc, char *argv[]) {
+    unsigned int iterations = 100;
+    std::string baselineIn;
+    std::string baselineOut;
+    double tolerance = 0.10;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:b:w:t:")) != -1) {
+        switch (opt) {
+        case 'i': iterations = std::atoi(optarg); break;
+        case 'b': baselineIn = optarg; break;
+        case 'w': baselineOut = optarg; break;
+        case 't': tolerance = std::atof(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+    }
+
+    ReplayHarness_xmlrpc_c harness;
+    registerTypes(harness);
+    bool ok = true;
+    try {
+        harness.loadDirectory(argv[optind]);
+        ok &= harness.run(std::cout, iterations);
+        if (! baselineOut.empty()) {
+            harness.writeBaseline(baselineOut);
+        }
+        if (! baselineIn.empty()) {
+            ok &= harness.compareBaseline(baselineIn, tolerance, std::cout);
+        }
+    } catch (std::exception & e) {
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        return(2);
+    }
+    return(ok ? 0 : 1);
+}
@@ -0,0 +1,289 @@
+// stressArchive.cpp
+//  Created on: Oct 18, 2026
+
+/// Concurrency stress and scaling test for the archives.
+///
+/// Threads save and load the same and different types at once: each thread
+/// round-trips its own objects, and all threads load from, and read, shared
+/// inputs (an archived xmlrpc_c::value, a KeyDictionary_xmlrpc_c, an object
+/// with an undecoded LazyXmlrpcSerializable member and a SharedBuffer_xmlrpc_c,
+/// and a type with registered migrations). Every result is checked. The test
+/// runs with 1, 2, 4, ... threads, reporting throughput and speedup over a
+/// single thread.
+///
+/// Build with "scons tsan=1" for stressArchive_tsan, instrumented with
+/// ThreadSanitizer, to check for data races as well.
+///
+/// Usage: stressArchive [-t <max threads>] [-i <iterations>] [-s <min speedup>]
+///
+///   -t  largest number of threads (default: hardware concurrency)
+///   -i  iterations per thread (default 2000)
+///   -s  fail unless the speedup at max threads is at least this
+///
+/// Exit status is 0 on success, 1 if any result was wrong or the speedup was
+/// too low, and 2 on usage errors.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <xmlrpc-c/base.hpp>
+#include <boost/serialization/nvp.hpp>
+#include "Archive_xmlrpc_c.h"
+#include "Archive_json.h"
+#include "Sizer_xmlrpc_c.h"
+
+enum Mode { MODE_IDLE, MODE_SCAN, MODE_TRACK };
+
+/// Subsystem status, covering each type of member
+class Subsystem {
+public:
+    Subsystem() :
+        _name("receiver"),
+        _temperature(38.5),
+        _faultCount(0),
+        _counter(UINT64_MAX),
+        _mode(MODE_SCAN),
+        _voltage(27.9f) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_name);
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_faultCount);
+        ar & BOOST_SERIALIZATION_NVP(_counter);
+        ar & BOOST_SERIALIZATION_NVP(_mode);
+        ar & BOOST_SERIALIZATION_NVP(_voltage);
+    }
+
+    std::string _name;
+    double _temperature;
+    int _faultCount;
+    uint64_t _counter;
+    Mode _mode;
+    FixedDecimals_xmlrpc_c<float, 2> _voltage;
+};
+
+/// Top-level status with nested, lazy and shared members
+class Status {
+public:
+    Status() :
+        _hostname("radar-host-01"),
+        _ok(true) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_hostname);
+        ar & BOOST_SERIALIZATION_NVP(_ok);
+        ar & BOOST_SERIALIZATION_NVP(_transmitter);
+        ar & BOOST_SERIALIZATION_NVP(_receiver);
+        ar & BOOST_SERIALIZATION_NVP(_log);
+    }
+
+    std::string _hostname;
+    bool _ok;
+    Subsystem _transmitter;
+    LazyXmlrpcSerializable<Subsystem> _receiver;
+    SharedString_xmlrpc_c _log;
+};
+
+/// Class at version 1, with a migration registered from version 0
+class Versioned {
+public:
+    Versioned() : _level(0) {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_level);
+    }
+
+    int _level;
+};
+BOOST_CLASS_VERSION(Versioned, 1)
+
+/// Read-only inputs shared by all threads
+struct SharedInputs {
+    xmlrpc_c::value statusVal;
+    KeyDictionary_xmlrpc_c keyDict;
+    xmlrpc_c::value compactVal;
+    xmlrpc_c::value oldVersionedVal;
+    std::string json;
+    // Loaded from statusVal, with its lazy member not yet decoded
+    XmlrpcSerializable<Status> status;
+};
+
+/// Run the given number of iterations, returning the number of wrong results
+static unsigned int
+worker(const SharedInputs & in, unsigned int threadIndex, unsigned int iterations) {
+    unsigned int failures = 0;
+    // Long-lived object updated in place
+    Status merged;
+    for (unsigned int i = 0; i < iterations; i++) {
+        // Round trip an object of our own
+        XmlrpcSerializable<Status> own;
+        own._transmitter._faultCount = threadIndex * iterations + i;
+        own._receiver.getMutable()._name = "rx";
+        own._log = std::string(256, 'a' + threadIndex % 26);
+        XmlrpcSerializable<Status> ownCopy(own.toValueStruct(0, ElideDefaults_xmlrpc_c),
+                                           0, ElideDefaults_xmlrpc_c);
+        failures += ownCopy._transmitter._faultCount != own._transmitter._faultCount ||
+                    ownCopy._receiver->_name != "rx" ||
+                    ownCopy._log.get() != own._log.get();
+
+        // Load from the shared value, plainly, with compact keys, and by
+        // merging
+        XmlrpcSerializable<Status> loaded(in.statusVal);
+        XmlrpcSerializable<Status> compact(in.compactVal, &in.keyDict);
+        mergeInto_xmlrpc_c(merged, in.statusVal);
+        failures += loaded._hostname != in.status._hostname ||
+                    loaded._receiver->_faultCount != 7 ||
+                    compact._transmitter._counter != UINT64_MAX ||
+                    compact._receiver->_faultCount != 7 ||
+                    merged._receiver->_faultCount != 7;
+
+        // Upgrade an old version
+        XmlrpcSerializable<Versioned> upgraded(in.oldVersionedVal);
+        failures += upgraded._level != 3;
+
+        // Read the shared object, whose lazy member is decoded by whichever
+        // thread gets there first, and pass it through an archive
+        failures += in.status._receiver->_faultCount != 7 ||
+                    in.status._log.size() != 4096;
+        XmlrpcSerializable<Status> passed(in.status.toValueStruct());
+        failures += passed._receiver->_faultCount != 7;
+
+        // JSON and sizing
+        std::ostringstream os;
+        {
+            Oarchive_json joa(os);
+            joa << static_cast<const Status &>(own);
+        }
+        Status jsonCopy;
+        Iarchive_json jia(os.str());
+        jia >> jsonCopy;
+        failures += jsonCopy._transmitter._faultCount != own._transmitter._faultCount ||
+                    serializedSize_xmlrpc_c(own).jsonBytes != os.str().size();
+        Status sharedJsonCopy;
+        Iarchive_json sharedJia(in.json);
+        sharedJia >> sharedJsonCopy;
+        failures += sharedJsonCopy._receiver->_faultCount != 7;
+    }
+    return(failures);
+}
+
+/// Build the shared inputs
+static void
+makeInputs(SharedInputs & in) {
+    XmlrpcSerializable<Status> status;
+    status._hostname = "shared-host";
+    status._receiver.getMutable()._faultCount = 7;
+    status._log = std::string(4096, 'x');
+    in.statusVal = status.toValueStruct();
+    in.compactVal = status.toValueStruct(&in.keyDict);
+    std::ostringstream os;
+    {
+        Oarchive_json joa(os);
+        joa << static_cast<const Status &>(status);
+    }
+    in.json = os.str();
+    in.status = XmlrpcSerializable<Status>(in.statusVal);
+
+    std::map<std::string, xmlrpc_c::value> oldVersioned;
+    oldVersioned["class_version"] = xmlrpc_c::value_int(0);
+    oldVersioned["_oldLevel"] = xmlrpc_c::value_int(3);
+    in.oldVersionedVal = xmlrpc_c::value_struct(oldVersioned);
+}
+
+static void
+usage(const char * progName) {
+    std::cerr << "Usage: " << progName << " [-t <max threads>] [-i <iterations>] " <<
+                 "[-s <min speedup>]" << std::endl;
+    exit(2);
+}
+
+int
+main(int argc, char *argv[]) {
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    unsigned int iterations = 2000;
+    double minSpeedup = 0.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:i:s:")) != -1) {
+        switch (opt) {
+        case 't': maxThreads = std::atoi(optarg); break;
+        case 'i': iterations = std::atoi(optarg); break;
+        case 's': minSpeedup = std::atof(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || iterations == 0) {
+        usage(argv[0]);
+    }
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    // Migrations must be registered before any thread loads a Versioned
+    Migrations_xmlrpc_c<Versioned>::from(0).rename("_oldLevel", "_level");
+
+    bool fail = false;
+    double singleRate = 0.0;
+    double speedup = 1.0;
+    for (unsigned int nThreads = 1; ; nThreads *= 2) {
+        if (nThreads > maxThreads) {
+            nThreads = maxThreads;
+        }
+        // Fresh inputs for each run, so that the shared lazy member is
+        // decoded concurrently each time
+        SharedInputs in;
+        makeInputs(in);
+
+        // Start the threads, then let them all go at once
+        std::atomic<unsigned int> failures(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < nThreads; t++) {
+            threads.push_back(std::thread([&in, &failures, &go, t, iterations]() {
+                while (! go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                failures += worker(in, t, iterations);
+            }));
+        }
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (size_t t = 0; t < threads.size(); t++) {
+            threads[t].join();
+        }
+        std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+        double rate = nThreads * iterations / elapsed.count();
+        if (nThreads == 1) {
+            singleRate = rate;
+        }
+        speedup = rate / singleRate;
+        std::cout << nThreads << " threads: " << rate << " iterations/s, speedup " <<
+                     speedup << ", " << failures << " wrong results" << std::endl;
+        fail |= (failures != 0);
+
+        if (nThreads == maxThreads) {
+            break;
+        }
+    }
+    if (speedup < minSpeedup) {
+        std::cout << "speedup " << speedup << " is below " << minSpeedup << std::endl;
+        fail = true;
+    }
+    return(fail ? 1 : 0);
+}
@@ -4,11 +4,18 @@
 
 /// Test Archive_xmlrpc_c serialization
 
+#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include <xmlrpc-c/base.hpp>
 #include <boost/serialization/nvp.hpp>
 #include "Archive_xmlrpc_c.h"
+#include "Archive_xmlrpc_c_instantiate.h"
+#include "Archive_json.h"
+#include "Sizer_xmlrpc_c.h"
 
 class TestClass {
 public:
@@ -55,6 +62,132 @@ public:
     uint64_t _ui64Bit;
 };
 
+/// Class with a nested serializable class member
+class OuterClass {
+public:
+    OuterClass() :
+        _name("outer"),
+        _scale(0.5),
+        _enabled(true) {}
+
+    virtual ~OuterClass() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_name);
+        ar & BOOST_SERIALIZATION_NVP(_scale);
+        ar & BOOST_SERIALIZATION_NVP(_enabled);
+        ar & BOOST_SERIALIZATION_NVP(_inner);
+    }
+
+    std::string _name;
+    double _scale;
+    bool _enabled;
+    TestClass _inner;
+};
+// The archive code for OuterClass is instantiated once, at the end of this file
+ARCHIVE_XMLRPC_C_EXTERN(OuterClass)
+
+/// Same archived content as OuterClass, but with a lazily decoded member
+class LazyOuterClass {
+public:
+    LazyOuterClass() :
+        _name(),
+        _scale(0.0),
+        _enabled(false) {}
+
+    virtual ~LazyOuterClass() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_name);
+        ar & BOOST_SERIALIZATION_NVP(_scale);
+        ar & BOOST_SERIALIZATION_NVP(_enabled);
+        ar & BOOST_SERIALIZATION_NVP(_inner);
+    }
+
+    std::string _name;
+    double _scale;
+    bool _enabled;
+    LazyXmlrpcSerializable<TestClass> _inner;
+};
+
+/// Class with string and byte string members, plain and shared
+class BufferClass {
+public:
+    BufferClass() {}
+
+    virtual ~BufferClass() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_log);
+        ar & BOOST_SERIALIZATION_NVP(_blob);
+        ar & BOOST_SERIALIZATION_NVP(_sharedLog);
+        ar & BOOST_SERIALIZATION_NVP(_sharedBlob);
+    }
+
+    std::string _log;
+    std::vector<unsigned char> _blob;
+    SharedString_xmlrpc_c _sharedLog;
+    SharedBytes_xmlrpc_c _sharedBlob;
+};
+
+/// Class at version 2, with migrations registered from versions 0 and 1
+class VersionedClass {
+public:
+    VersionedClass() :
+        _temperature(0.0),
+        _count(0),
+        _loadedVersion(0) {}
+
+    virtual ~VersionedClass() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_units);
+        ar & BOOST_SERIALIZATION_NVP(_count);
+        _loadedVersion = version;
+    }
+
+    double _temperature;
+    std::string _units;
+    int _count;
+    unsigned int _loadedVersion;
+};
+BOOST_CLASS_VERSION(VersionedClass, 2)
+
+/// Class with members archived as scaled integers
+class TelemetryClass {
+public:
+    TelemetryClass() {}
+
+    virtual ~TelemetryClass() {}
+
+    friend class boost::serialization::access;
+
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int version) {
+        ar & BOOST_SERIALIZATION_NVP(_temperature);
+        ar & BOOST_SERIALIZATION_NVP(_range);
+        ar & BOOST_SERIALIZATION_NVP(_powers);
+    }
+
+    // degrees C to 0.01, with -40 encoded as 0
+    ScaledFloat_xmlrpc_c<float, std::ratio<1, 100>, std::ratio<-40> > _temperature;
+    FixedDecimals_xmlrpc_c<double, 3> _range;
+    ScaledFloatArray_xmlrpc_c<float, std::ratio<1, 10> > _powers;
+};
+
 //xmlrpc_c::value_struct
 //TestClass::toXmlRpcValue() const {
 //    std::map<std::string, xmlrpc_c::value> statusDict;
@@ -68,6 +201,30 @@ public:
 //    return(xmlrpc_c::value_struct(statusDict));
 //}
 
+/// Return the number of entries in the given dictionary, including those in
+/// nested dictionaries
+static size_t
+countFields(const xmlrpc_c::value_struct & dict) {
+    std::map<std::string, xmlrpc_c::value> entries(dict);
+    size_t count = entries.size();
+    for (auto it = entries.begin(); it != entries.end(); it++) {
+        if (it->second.type() == xmlrpc_c::value::TYPE_STRUCT) {
+            count += countFields(xmlrpc_c::value_struct(it->second));
+        }
+    }
+    return(count);
+}
+
+/// Set the given dictionary entry, replacing any existing one. An
+/// xmlrpc_c::value which already holds a value cannot be assigned to, so an
+/// existing entry is erased first.
+static void
+replaceField(std::map<std::string, xmlrpc_c::value> & dict,
+             const std::string & key, const xmlrpc_c::value & value) {
+    dict.erase(key);
+    dict.insert(std::make_pair(key, value));
+}
+
 int
 main(int argc, char *argv[]) {
     TestClass tc;
@@ -114,4 +271,388 @@ main(int argc, char *argv[]) {
     std::cout << "uint64_t " << (ok ? "GOOD" : "BAD") << std::endl;
     fail |= !ok;
 
+    // Compact keys: archive an array of structs sharing one key dictionary,
+    // then unpack using a dictionary rebuilt from its transmitted form.
+    KeyDictionary_xmlrpc_c keyDict;
+    std::vector<xmlrpc_c::value> compactArray;
+    for (int i = 0; i < 3; i++) {
+        XmlrpcSerializable<OuterClass> outer;
+        outer._scale = i;
+        outer._inner._i32Bit = i;
+        compactArray.push_back(outer.toValueStruct(&keyDict));
+    }
+    KeyDictionary_xmlrpc_c peerKeyDict(keyDict.toValueArray());
+    ok = (keyDict.size() == 12 && peerKeyDict.size() == 12);
+    for (int i = 0; i < 3; i++) {
+        std::map<std::string, xmlrpc_c::value> compactMap =
+                xmlrpc_c::value_struct(compactArray[i]);
+        ok &= (compactMap.find("_scale") == compactMap.end());
+        XmlrpcSerializable<OuterClass> outer(compactArray[i], &peerKeyDict);
+        ok &= (outer._scale == i && outer._inner._i32Bit == i &&
+               outer._name == "outer" && outer._inner._ui64Bit == UINT64_MAX);
+    }
+    std::cout << "compact keys " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Default elision: only non-default members should be written, and the
+    // rest filled from defaults on load, even into a non-default object.
+    XmlrpcSerializable<OuterClass> sparse;
+    sparse._scale = -0.0;
+    sparse._inner._ui8Bit = 7;
+    std::map<std::string, xmlrpc_c::value> sparseMap =
+            xmlrpc_c::value_struct(sparse.toValueStruct(0, ElideDefaults_xmlrpc_c));
+    std::map<std::string, xmlrpc_c::value> sparseInnerMap =
+            xmlrpc_c::value_struct(sparseMap["_inner"]);
+    ok = (sparseMap.size() == 3 && sparseMap.count("_scale") &&
+          sparseInnerMap.size() == 2 && sparseInnerMap.count("_ui8Bit"));
+    XmlrpcSerializable<OuterClass> emptyOuter;
+    ok &= (xmlrpc_c::value_struct(emptyOuter.toValueStruct(0, ElideDefaults_xmlrpc_c))
+           .cvalue().size() == 1);
+    // Lazy members are omitted in the same way, including one which is
+    // passed through undecoded
+    XmlrpcSerializable<LazyOuterClass> emptyLazy;
+    std::map<std::string, xmlrpc_c::value> emptyLazyMap =
+            xmlrpc_c::value_struct(emptyLazy.toValueStruct(0, ElideDefaults_xmlrpc_c));
+    ok &= (emptyLazyMap.size() == 1);
+    std::map<std::string, xmlrpc_c::value> versionOnly;
+    versionOnly["class_version"] = xmlrpc_c::value_int(0);
+    emptyLazyMap["_inner"] = xmlrpc_c::value_struct(versionOnly);
+    XmlrpcSerializable<LazyOuterClass> undecodedLazy(xmlrpc_c::value_struct(emptyLazyMap),
+                                                     0, ElideDefaults_xmlrpc_c);
+    ok &= (xmlrpc_c::value_struct(undecodedLazy.toValueStruct(0, ElideDefaults_xmlrpc_c))
+           .cvalue().size() == 1 && ! undecodedLazy._inner.isDecoded());
+    OuterClass target;
+    target._name = "changed";
+    target._enabled = false;
+    target._inner._i64Bit = 0;
+    Iarchive_xmlrpc_c sparseIar(sparseMap, 0, ElideDefaults_xmlrpc_c);
+    sparseIar >> target;
+    ok &= (target._name == "outer" && target._enabled && std::signbit(target._scale) &&
+           target._inner._ui8Bit == 7 && target._inner._i64Bit == INT64_MIN);
+    std::cout << "default elision " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Lazy nested decoding: the nested member should stay undecoded through
+    // a load and re-save, and decode correctly on first access.
+    XmlrpcSerializable<OuterClass> eager;
+    eager._inner._i16Bit = 42;
+    XmlrpcSerializable<LazyOuterClass> lazy(eager);
+    ok = (! lazy._inner.isDecoded() && lazy._name == "outer");
+    XmlrpcSerializable<LazyOuterClass> lazyCopy(lazy);
+    XmlrpcSerializable<OuterClass> reloaded(lazyCopy);
+    ok &= (! lazy._inner.isDecoded() && ! lazyCopy._inner.isDecoded() &&
+           reloaded._inner._i16Bit == 42);
+    ok &= (lazy._inner->_i16Bit == 42 && lazy._inner.isDecoded());
+    lazy._inner.getMutable()._i16Bit = 43;
+    XmlrpcSerializable<OuterClass> modified(lazy);
+    ok &= (modified._inner._i16Bit == 43);
+    std::cout << "lazy nested " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Strings and byte strings, plain and shared
+    XmlrpcSerializable<BufferClass> buffers;
+    buffers._log = std::string(4096, 'x');
+    buffers._blob.assign(1000, 0xA5);
+    buffers._sharedLog = std::string(4096, 'y');
+    buffers._sharedBlob = std::vector<unsigned char>(1000, 0x5A);
+    XmlrpcSerializable<BufferClass> buffersCopy(buffers.toValueStruct());
+    ok = (buffersCopy._log == buffers._log && buffersCopy._blob == buffers._blob &&
+          buffersCopy._sharedLog.size() == 4096 &&
+          buffersCopy._sharedLog.get() == buffers._sharedLog.get() &&
+          buffersCopy._sharedBlob.get() == buffers._sharedBlob.get());
+    std::cout << "strings and bytes " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // JSON archives
+    OuterClass jsonOuter;
+    jsonOuter._name = "quote \" backslash \\ tab \t \xc3\xa9";
+    jsonOuter._scale = 1.0 / 3.0;
+    // Each archive holds a single object, completed by finish() or on
+    // destruction, and refuses a second one
+    std::ostringstream jsonStream;
+    std::ostringstream jsonBufferStream;
+    bool jsonThrew = false;
+    {
+        Oarchive_json joa(jsonStream);
+        joa << jsonOuter;
+        try {
+            joa << static_cast<const BufferClass &>(buffers);
+        } catch (std::runtime_error &) {
+            jsonThrew = true;
+        }
+        joa.finish();
+    }
+    {
+        Oarchive_json joa(jsonBufferStream);
+        joa << static_cast<const BufferClass &>(buffers);
+    }
+    OuterClass jsonOuterCopy;
+    BufferClass jsonBuffers;
+    Iarchive_json jia(jsonStream.str());
+    jia >> jsonOuterCopy;
+    Iarchive_json bufferJia(jsonBufferStream.str());
+    bufferJia >> jsonBuffers;
+    ok = (jsonThrew && jsonOuterCopy._name == jsonOuter._name &&
+          jsonOuterCopy._scale == jsonOuter._scale &&
+          jsonOuterCopy._inner._i8Bit == INT8_MIN &&
+          jsonOuterCopy._inner._ui32Bit == UINT32_MAX &&
+          jsonOuterCopy._inner._i64Bit == INT64_MIN &&
+          jsonOuterCopy._inner._ui64Bit == UINT64_MAX &&
+          jsonBuffers._log == buffers._log && jsonBuffers._blob == buffers._blob &&
+          jsonBuffers._sharedBlob.get() == buffers._sharedBlob.get());
+    std::cout << "json " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Schema migrations: a version 0 dictionary should be upgraded before
+    // loading, and a current one loaded as is.
+    {
+        // Version 0 had _temp in place of _temperature, and no _units
+        Migrations_xmlrpc_c<VersionedClass>::from(0)
+            .rename("_temp", "_temperature")
+            .setDefault("_units", xmlrpc_c::value_string("K"));
+        // Version 1 had _legacyFlag, and _count in tens
+        Migrations_xmlrpc_c<VersionedClass>::from(1)
+            .drop("_legacyFlag")
+            .transform("_count", [](const xmlrpc_c::value & v) {
+                return(xmlrpc_c::value(xmlrpc_c::value_int(10 * int(xmlrpc_c::value_int(v)))));
+            });
+
+        std::map<std::string, xmlrpc_c::value> oldDict;
+        oldDict["class_version"] = xmlrpc_c::value_int(0);
+        oldDict["_temp"] = xmlrpc_c::value_double(300.0);
+        // A stale entry under the new name must be replaced by the rename
+        oldDict["_temperature"] = xmlrpc_c::value_double(-1.0);
+        oldDict["_legacyFlag"] = xmlrpc_c::value_boolean(true);
+        oldDict["_count"] = xmlrpc_c::value_int(3);
+        XmlrpcSerializable<VersionedClass> upgraded((xmlrpc_c::value_struct(oldDict)));
+
+        VersionedClass current;
+        current._temperature = 12.5;
+        current._units = "C";
+        current._count = 7;
+        xmlrpc_c::value_struct currentStruct =
+                XmlrpcSerializable<VersionedClass>(current).toValueStruct();
+        std::map<std::string, xmlrpc_c::value> currentDict(currentStruct);
+        XmlrpcSerializable<VersionedClass> reloaded(currentStruct);
+
+        ok = upgraded._temperature == 300.0 && upgraded._units == "K" &&
+             upgraded._count == 30 && upgraded._loadedVersion == 2 &&
+             int(xmlrpc_c::value_int(currentDict["class_version"])) == 2 &&
+             reloaded._temperature == 12.5 && reloaded._units == "C" &&
+             reloaded._count == 7 && reloaded._loadedVersion == 2;
+
+        // Once a VersionedClass has been loaded, its migrations are fixed
+        bool threw = false;
+        try {
+            Migrations_xmlrpc_c<VersionedClass>::from(2);
+        } catch (std::runtime_error &) {
+            threw = true;
+        }
+        ok &= threw;
+    }
+    std::cout << "migrations " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Numeric coercion: integers of the other width and whole doubles for
+    // integral members, and integers for double members, as a dynamically
+    // typed peer might send them
+    {
+        XmlrpcSerializable<OuterClass> loose;
+        std::map<std::string, xmlrpc_c::value> looseMap = loose.toValueStruct();
+        std::map<std::string, xmlrpc_c::value> looseInner =
+                xmlrpc_c::value_struct(looseMap["_inner"]);
+        replaceField(looseInner, "_i16Bit", xmlrpc_c::value_double(-300.0));
+        replaceField(looseInner, "_i32Bit", xmlrpc_c::value_i8(-5));
+        replaceField(looseInner, "_ui32Bit", xmlrpc_c::value_i8(4000000000LL));
+        replaceField(looseInner, "_i64Bit", xmlrpc_c::value_int(-7));
+        replaceField(looseInner, "_ui64Bit", xmlrpc_c::value_double(1.8e19));
+        replaceField(looseMap, "_inner", xmlrpc_c::value_struct(looseInner));
+        replaceField(looseMap, "_scale", xmlrpc_c::value_int(3));
+        XmlrpcSerializable<OuterClass> coerced(xmlrpc_c::value_struct(looseMap),
+                                               0, CoerceNumbers_xmlrpc_c);
+        ok = coerced._scale == 3.0 && coerced._inner._i16Bit == -300 &&
+             coerced._inner._i32Bit == -5 && coerced._inner._ui32Bit == 4000000000U &&
+             coerced._inner._i64Bit == -7 &&
+             coerced._inner._ui64Bit == 18000000000000000000ULL;
+
+        // Without the flags, or with a fractional value, the load must fail
+        bool threw = false;
+        try {
+            XmlrpcSerializable<OuterClass> strict((xmlrpc_c::value_struct(looseMap)));
+        } catch (...) {
+            threw = true;
+        }
+        ok &= threw;
+        replaceField(looseInner, "_i32Bit", xmlrpc_c::value_double(1.5));
+        replaceField(looseMap, "_inner", xmlrpc_c::value_struct(looseInner));
+        threw = false;
+        try {
+            XmlrpcSerializable<OuterClass> fractional(xmlrpc_c::value_struct(looseMap),
+                                                      0, CoerceNumbers_xmlrpc_c);
+        } catch (std::runtime_error &) {
+            threw = true;
+        }
+        ok &= threw;
+
+        // Coerced values must fit the member's own type, not just its
+        // archived width
+        std::map<std::string, xmlrpc_c::value> narrowInner =
+                XmlrpcSerializable<TestClass>().toValueStruct();
+        replaceField(narrowInner, "_i8Bit", xmlrpc_c::value_double(-128.0));
+        replaceField(narrowInner, "_ui16Bit", xmlrpc_c::value_i8(65535));
+        XmlrpcSerializable<TestClass> narrow(xmlrpc_c::value_struct(narrowInner),
+                                             0, CoerceNumbers_xmlrpc_c);
+        ok &= narrow._i8Bit == -128 && narrow._ui16Bit == 65535;
+        const std::pair<const char *, xmlrpc_c::value> outOfRange[] = {
+            { "_i8Bit", xmlrpc_c::value_double(300.0) },
+            { "_i8Bit", xmlrpc_c::value_double(-129.0) },
+            { "_ui16Bit", xmlrpc_c::value_i8(70000) },
+            { "_ui16Bit", xmlrpc_c::value_i8(-1) },
+            { "_ui8Bit", xmlrpc_c::value_double(-1.0) },
+        };
+        for (const auto & bad : outOfRange) {
+            std::map<std::string, xmlrpc_c::value> badInner(narrowInner);
+            replaceField(badInner, bad.first, bad.second);
+            threw = false;
+            try {
+                XmlrpcSerializable<TestClass> wrapped(xmlrpc_c::value_struct(badInner),
+                                                      0, CoerceNumbers_xmlrpc_c);
+            } catch (std::runtime_error &) {
+                threw = true;
+            }
+            ok &= threw;
+        }
+    }
+    std::cout << "numeric coercion " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Sizing: the field counts should match the dictionaries written by
+    // Oarchive_xmlrpc_c, and the JSON size the text written by Oarchive_json
+    {
+        XmlrpcSerializable<OuterClass> sized;
+        sized._name = "quote \" and \x01";
+        sized._scale = 1.0 / 3.0;
+        sized._inner._ui8Bit = 7;
+        std::ostringstream sizedJson;
+        {
+            Oarchive_json joa(sizedJson);
+            joa << static_cast<const OuterClass &>(sized);
+        }
+        SerializedSize_xmlrpc_c size = serializedSize_xmlrpc_c(sized);
+        SerializedSize_xmlrpc_c sparseSize =
+                serializedSize_xmlrpc_c(sized, ElideDefaults_xmlrpc_c);
+        ok = size.jsonBytes == sizedJson.str().size() &&
+             size.fieldCount == countFields(sized.toValueStruct()) &&
+             sparseSize.fieldCount ==
+                 countFields(sized.toValueStruct(0, ElideDefaults_xmlrpc_c)) &&
+             sparseSize.jsonBytes == size.jsonBytes &&
+             sparseSize.xmlrpcBytes < size.xmlrpcBytes;
+
+        // A lazy member passed through undecoded is sized from its original
+        // value, without decoding it, including a member its type doesn't
+        // know
+        std::map<std::string, xmlrpc_c::value> extraMap = sized.toValueStruct();
+        std::map<std::string, xmlrpc_c::value> extraInner =
+                xmlrpc_c::value_struct(extraMap["_inner"]);
+        const std::string extraText(1000, 'x');
+        extraInner["_unknown"] = xmlrpc_c::value_string(extraText);
+        replaceField(extraMap, "_inner", xmlrpc_c::value_struct(extraInner));
+        XmlrpcSerializable<LazyOuterClass> lazySized((xmlrpc_c::value_struct(extraMap)));
+        SerializedSize_xmlrpc_c lazySize = serializedSize_xmlrpc_c(lazySized);
+        ok &= lazySize.fieldCount == countFields(lazySized.toValueStruct()) &&
+              lazySize.fieldCount == size.fieldCount + 1 &&
+              lazySize.xmlrpcBytes >= size.xmlrpcBytes + extraText.size() &&
+              lazySize.jsonBytes == size.jsonBytes + std::string(",\"_unknown\":").size() +
+                                    extraText.size() + 2 &&
+              ! lazySized._inner.isDecoded();
+    }
+    std::cout << "sizing " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Merge update: members in the update are loaded into the existing
+    // object, keeping the string's buffer, and the others are left alone
+    {
+        OuterClass state;
+        state._name.reserve(1024);
+        state._name = "state";
+        state._scale = 2.5;
+        state._inner._i16Bit = 42;
+        const char * nameBuffer = state._name.data();
+
+        std::map<std::string, xmlrpc_c::value> innerUpdate;
+        innerUpdate["class_version"] = xmlrpc_c::value_int(0);
+        innerUpdate["_ui8Bit"] = xmlrpc_c::value_int(9);
+        std::map<std::string, xmlrpc_c::value> update;
+        update["class_version"] = xmlrpc_c::value_int(0);
+        update["_name"] = xmlrpc_c::value_string("updated");
+        update["_inner"] = xmlrpc_c::value_struct(innerUpdate);
+        mergeInto_xmlrpc_c(state, xmlrpc_c::value_struct(update));
+
+        ok = state._name == "updated" && state._name.data() == nameBuffer &&
+             state._scale == 2.5 && state._enabled &&
+             state._inner._ui8Bit == 9 && state._inner._i16Bit == 42 &&
+             state._inner._i64Bit == INT64_MIN;
+
+        // Byte strings likewise keep their buffer
+        BufferClass bufferState;
+        bufferState._blob.reserve(1024);
+        const unsigned char * blobBuffer = bufferState._blob.data();
+        std::map<std::string, xmlrpc_c::value> blobUpdate;
+        blobUpdate["class_version"] = xmlrpc_c::value_int(0);
+        blobUpdate["_blob"] = xmlrpc_c::value_bytestring(std::vector<unsigned char>(100, 0x3C));
+        mergeInto_xmlrpc_c(bufferState, xmlrpc_c::value_struct(blobUpdate));
+        ok &= bufferState._blob == std::vector<unsigned char>(100, 0x3C) &&
+              bufferState._blob.data() == blobBuffer;
+    }
+    std::cout << "merge update " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    // Scaled floats: values should be saved as rounded integers and come
+    // back to within half a step, from both xmlrpc_c and JSON archives
+    {
+        XmlrpcSerializable<TelemetryClass> telemetry;
+        telemetry._temperature = 21.456f;
+        telemetry._range = 1234.5675;
+        telemetry._powers = std::vector<float>{ -3.14f, 0.0f, 0.05f, 99.96f };
+        std::map<std::string, xmlrpc_c::value> telemetryMap = telemetry.toValueStruct();
+        std::vector<xmlrpc_c::value> powers =
+                xmlrpc_c::value_array(telemetryMap["_powers"]).vectorValueValue();
+        XmlrpcSerializable<TelemetryClass> reloaded((xmlrpc_c::value_struct(telemetryMap)));
+        ok = int(xmlrpc_c::value_int(telemetryMap["_temperature"])) == 6146 &&
+             int(xmlrpc_c::value_int(telemetryMap["_range"])) == 1234568 &&
+             powers.size() == 4 && int(xmlrpc_c::value_int(powers[0])) == -31 &&
+             int(xmlrpc_c::value_int(powers[2])) == 1 &&
+             std::fabs(reloaded._temperature - 21.46f) < 1e-4 &&
+             std::fabs(reloaded._range - 1234.568) < 1e-9 &&
+             reloaded._powers.size() == 4 &&
+             std::fabs(reloaded._powers[3] - 100.0f) < 1e-4;
+
+        std::ostringstream telemetryJson;
+        {
+            Oarchive_json joa(telemetryJson);
+            joa << static_cast<const TelemetryClass &>(telemetry);
+        }
+        TelemetryClass jsonTelemetry;
+        Iarchive_json jia(telemetryJson.str());
+        jia >> jsonTelemetry;
+        ok &= jsonTelemetry._range == reloaded._range &&
+              jsonTelemetry._powers == reloaded._powers &&
+              serializedSize_xmlrpc_c(telemetry).jsonBytes == telemetryJson.str().size();
+
+        // Values which don't fit the encoding must not be saved
+        telemetry._powers.push_back(NAN);
+        bool threw = false;
+        try {
+            telemetry.toValueStruct();
+        } catch (std::runtime_error &) {
+            threw = true;
+        }
+        ok &= threw;
+    }
+    std::cout << "scaled floats " << (ok ? "GOOD" : "BAD") << std::endl;
+    fail |= !ok;
+
+    return(fail ? 1 : 0);
 }
+
+ARCHIVE_XMLRPC_C_INSTANTIATE(OuterClass)
@@ -9,6 +9,11 @@ tools = Split('''
 ''')
 env = Environment(tools=['default'] + tools)
 
+# The archives use std::mutex and std::atomic, and stressArchive uses
+# std::thread, so build and link everything with thread support
+threadFlags = ['-pthread']
+env.AppendUnique(CCFLAGS = threadFlags, LINKFLAGS = threadFlags)
+
 tooldir = env.Dir('.').srcnode().abspath    # this directory
 
 # The library and header files will live in this directory.
@@ -16,18 +21,50 @@ libDir = tooldir
 includeDir = tooldir
 
 sources = Split('''
+    Archive_json.cpp
     Archive_xmlrpc_c.cpp
+    Sizer_xmlrpc_c.cpp
 ''')
 
 lib = env.Library('archive_xmlrpc_c', sources)
 Default(lib)
 
-testSerialization = env.Program('testSerialization', ['testSerialization.cpp'])
+# The programs use the non-template archive code and the precompiled
+# instantiations from the library
+progEnv = env.Clone()
+progEnv.Prepend(LIBS = [lib])
+
+testSerialization = progEnv.Program('testSerialization', ['testSerialization.cpp'])
 Default(testSerialization)
+
+benchJsonArchive = progEnv.Program('benchJsonArchive', ['benchJsonArchive.cpp'])
+Default(benchJsonArchive)
+
+benchScaledFloat = progEnv.Program('benchScaledFloat', ['benchScaledFloat.cpp'])
+Default(benchScaledFloat)
+
+replayArchive = progEnv.Program('replayArchive',
+                                ['replayArchive.cpp', 'ReplayHarness_xmlrpc_c.cpp'])
+Default(replayArchive)
+
+stressArchive = progEnv.Program('stressArchive', ['stressArchive.cpp'])
+Default(stressArchive)
+
+# With "scons tsan=1", also build stressArchive_tsan, with the archive code
+# compiled in and instrumented with ThreadSanitizer
+if int(ARGUMENTS.get('tsan', 0)):
+    tsanEnv = env.Clone()
+    tsanEnv.AppendUnique(CCFLAGS = ['-fsanitize=thread', '-g', '-O1'],
+                         LINKFLAGS = ['-fsanitize=thread'])
+    tsanObjects = [tsanEnv.Object(os.path.splitext(src)[0] + '_tsan', src)
+                   for src in sources + ['stressArchive.cpp']]
+    stressArchiveTsan = tsanEnv.Program('stressArchive_tsan', tsanObjects)
+    Default(stressArchiveTsan)
     
 def archive_xmlrpc_c(env):
     env.Require(tools)
     env.AppendUnique(CPPPATH = [includeDir])
+    env.AppendUnique(CCFLAGS = threadFlags, LINKFLAGS = threadFlags)
     env.Append(LIBS = [lib])
 
 Export('archive_xmlrpc_c')